@@ -0,0 +1,304 @@
+// 微基准测试 覆盖Buffer TimerWheel 日志和跨线程投递任务的热点路径
+// 每项结果输出为一行JSON 便于在不同提交之间用脚本比较
+// 编译: g++ -std=c++17 -O2 -DNDEBUG -pthread -o micro bench/micro.cpp
+// 用法: micro [名称过滤] 只运行名称包含过滤串的测试项
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <future>
+#include "../src/buffer.hpp"
+#include "../src/timerwheel.hpp"
+#include "../src/eventloop.hpp"
+#include "../src/loopthread.hpp"
+#include "../src/log.hpp"
+
+static const int BENCH_REPEAT = 5; // 每项测试重复次数 取最快的一次
+
+static const char *filter = nullptr; // 名称过滤串
+
+// 阻止编译器优化掉结果
+template <typename T>
+static inline void keep(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+static inline uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+static bool selected(const char *name)
+{
+    return filter == nullptr || strstr(name, filter) != nullptr;
+}
+
+// 输出一项结果 bytes_per_op为0时不输出吞吐量
+static void report(const char *name, uint64_t param, uint64_t ops, uint64_t ns, uint64_t bytes_per_op)
+{
+    double ns_per_op = ops > 0 ? static_cast<double>(ns) / ops : 0;
+    printf("{\"bench\":\"%s\",\"param\":%lu,\"ops\":%lu,\"ns_per_op\":%.2f", name, param, ops, ns_per_op);
+    if (bytes_per_op > 0 && ns > 0)
+        printf(",\"mib_per_s\":%.1f", static_cast<double>(bytes_per_op) * ops / (ns / 1e9) / (1024 * 1024));
+    printf("}\n");
+    fflush(stdout);
+}
+
+// 运行BENCH_REPEAT次 每次由setup准备状态 run执行ops次操作并计时 报告最快的一次
+template <typename Setup, typename Run>
+static void bench(const char *name, uint64_t param, uint64_t ops, uint64_t bytes_per_op, Setup setup, Run run)
+{
+    if (!selected(name))
+        return;
+
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < BENCH_REPEAT; i++)
+    {
+        setup();
+        uint64_t start = now_ns();
+        run();
+        uint64_t ns = now_ns() - start;
+        if (ns < best)
+            best = ns;
+    }
+    report(name, param, ops, best, bytes_per_op);
+}
+
+// 写入后立即读出 缓冲区保持为空 不发生扩容和搬移
+static void bench_buffer_write_read()
+{
+    size_t sizes[] = {16, 256, 4096, 65536};
+    for (size_t size : sizes)
+    {
+        uint64_t ops = (64 << 20) / size;
+        std::vector<char> data(size, 'a'), out(size);
+        Buffer buffer(size);
+        bench("buffer_write_read", size, ops, size, []() {}, [&]()
+              {
+            for (uint64_t i = 0; i < ops; i++)
+            {
+                buffer.write(data.data(), size);
+                buffer.read(out.data(), size);
+                keep(out[0]);
+            } });
+    }
+}
+
+// 缓冲区中始终积压backlog字节 每次写入和读出4K 后沿空间耗尽时ensure_writeable搬移积压数据到前端
+static void bench_buffer_compact()
+{
+    const size_t chunk = 4096;
+    size_t backlogs[] = {1024, 16384, 262144};
+    for (size_t backlog : backlogs)
+    {
+        uint64_t ops = 16384;
+        std::vector<char> data(backlog + chunk, 'b'), out(chunk);
+        Buffer buffer(backlog + chunk * 4); // 容量固定 不会扩容 每写入3个块搬移一次
+        bench("buffer_compact", backlog, ops, chunk, [&]()
+              {
+            buffer.clear();
+            buffer.write(data.data(), backlog); }, [&]()
+              {
+            for (uint64_t i = 0; i < ops; i++)
+            {
+                buffer.write(data.data(), chunk);
+                buffer.read(out.data(), chunk);
+                keep(out[0]);
+            } });
+    }
+}
+
+// 按行读取 每行line_len字节(含CRLF) 共约8MB
+static void bench_buffer_lines()
+{
+    size_t line_lens[] = {16, 128, 1024};
+    for (size_t line_len : line_lens)
+    {
+        std::string line(line_len - 2, 'x');
+        line += "\r\n";
+        uint64_t lines = (8 << 20) / line_len;
+        std::string text;
+        for (uint64_t i = 0; i < lines; i++)
+            text += line;
+
+        Buffer buffer(text.size());
+        auto fill = [&]()
+        {
+            buffer.clear();
+            buffer.write(text.data(), text.size());
+        };
+
+        bench("buffer_find_crlf", line_len, lines, line_len, fill, [&]()
+              {
+            for (uint64_t i = 0; i < lines; i++)
+            {
+                char *crlf = buffer.find_crlf();
+                keep(crlf);
+                buffer.move_read_off(crlf - buffer.begin_read() + 1);
+            } });
+
+        bench("buffer_read_line", line_len, lines, line_len, fill, [&]()
+              {
+            for (uint64_t i = 0; i < lines; i++)
+            {
+                std::string s = buffer.read_line();
+                keep(s.size());
+            } });
+
+        bench("buffer_peek_line", line_len, lines, line_len, fill, [&]()
+              {
+            for (uint64_t i = 0; i < lines; i++)
+            {
+                size_t line_size = 0;
+                std::string_view view = buffer.peek_line(&line_size);
+                keep(view.size());
+                buffer.move_read_off(line_size);
+            } });
+    }
+}
+
+// 时间轮 添加 刷新 推进的开销 定时间隔在1秒到1小时之间随机分布
+static void bench_timer_wheel()
+{
+    size_t counts[] = {10000, 100000, 1000000};
+    for (size_t count : counts)
+    {
+        std::mt19937_64 rng(count);
+        std::vector<uint64_t> intervals(count);
+        for (uint64_t &interval : intervals)
+            interval = 1000 + rng() % 3600000;
+
+        std::unique_ptr<TimerWheel> wheel;
+        std::vector<uint64_t> ids(count);
+        auto fill = [&]()
+        {
+            wheel.reset(new TimerWheel());
+            wheel->reserve(count);
+            for (size_t i = 0; i < count; i++)
+                ids[i] = wheel->timer_add(intervals[i], []() {});
+        };
+
+        bench("timerwheel_add", count, count, 0, [&]()
+              {
+            wheel.reset(new TimerWheel());
+            wheel->reserve(count); }, [&]()
+              {
+            for (size_t i = 0; i < count; i++)
+                ids[i] = wheel->timer_add(intervals[i], []() {});
+            keep(ids[count - 1]); });
+
+        // 按随机顺序刷新 模拟连接活动
+        std::vector<uint64_t> order(count);
+        for (uint64_t &index : order)
+            index = rng() % count;
+        bench("timerwheel_refresh", count, count, 0, fill, [&]()
+              {
+            for (size_t i = 0; i < count; i++)
+                keep(wheel->refresh_timer(ids[order[i]])); });
+
+        // 推进1秒 第0层每转一圈降级一次上层槽位
+        const uint64_t ticks = 1000;
+        bench("timerwheel_tick", count, ticks, 0, fill, [&]()
+              {
+            wheel->advance(wheel->current_tick() + ticks);
+            keep(wheel->size()); });
+
+        // 推进到所有定时器到期 包含降级与执行任务的开销 按到期的定时器计数
+        bench("timerwheel_expire", count, count, 0, fill, [&]()
+              {
+            wheel->advance(wheel->current_tick() + 3601000);
+            keep(wheel->size()); });
+    }
+}
+
+// 日志 被过滤时应接近零开销 开启时只测量前端写入异步缓冲区的开销
+static void bench_log()
+{
+    const uint64_t ops = 1000000;
+    int value = 42;
+
+    set_log_level(INFO);
+    bench("log_msg_filtered", 0, ops, 0, []() {}, [&]()
+          {
+        for (uint64_t i = 0; i < ops; i++)
+            LOG_MSG(DEBUG, "filtered message"); });
+
+    bench("log_fmt_filtered", 0, ops, 0, []() {}, [&]()
+          {
+        for (uint64_t i = 0; i < ops; i++)
+            LOG_FMT(DEBUG, "filtered message value={} name={}", value, "bench"); });
+
+    if (!selected("log_msg_enabled") && !selected("log_fmt_enabled"))
+        return;
+    if (!start_async_logging("/dev/null"))
+    {
+        LOG_MSG(ERROR, "start async logging failed.");
+        return;
+    }
+
+    bench("log_msg_enabled", 0, ops, 0, []() {}, [&]()
+          {
+        for (uint64_t i = 0; i < ops; i++)
+            LOG_MSG(INFO, "enabled message"); });
+
+    bench("log_fmt_enabled", 0, ops, 0, []() {}, [&]()
+          {
+        for (uint64_t i = 0; i < ops; i++)
+            LOG_FMT(INFO, "enabled message value={} name={}", value, "bench"); });
+
+    stop_async_logging();
+}
+
+// 跨线程投递任务 producers个线程共投递ops个任务 计时到最后一个任务在事件循环线程中执行完毕
+static void bench_task_queue()
+{
+    if (!selected("eventloop_post"))
+        return;
+
+    EventLoopThread thread;
+    EventLoop *loop = thread.start();
+    const uint64_t ops = 1000000;
+    int producer_counts[] = {1, 4};
+    for (int producers : producer_counts)
+    {
+        uint64_t executed = 0; // 只在事件循环线程中修改
+        bench("eventloop_post", producers, ops, 0, [&]()
+              { executed = 0; }, [&]()
+              {
+            std::vector<std::thread> threads;
+            for (int p = 0; p < producers; p++)
+                threads.emplace_back([&]()
+                                     {
+                    for (uint64_t i = 0; i < ops / producers; i++)
+                        loop->queue_in_loop([&executed]()
+                                            { executed++; }); });
+            for (std::thread &t : threads)
+                t.join();
+
+            std::promise<void> done;
+            loop->queue_in_loop([&]()
+                                { done.set_value(); });
+            done.get_future().wait();
+            keep(executed); });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1)
+        filter = argv[1];
+
+    bench_buffer_write_read();
+    bench_buffer_compact();
+    bench_buffer_lines();
+    bench_timer_wheel();
+    bench_log();
+    bench_task_queue();
+    return 0;
+}
@@ -0,0 +1,318 @@
+// 乒乓测试 在回环地址上测量吞吐量与延迟
+// 每个客户端连接同时只有一条消息在途 收到完整的回显后立即发送下一条 往返时间即为延迟
+// 编译: g++ -std=c++17 -O2 -DNDEBUG -DLOG_MIN_LEVEL=WARN -pthread -o pingpong bench/pingpong.cpp
+// 用法: pingpong [-m both|server|client] [-p 端口] [-c 连接数] [-s 消息字节数] [-t 线程数] [-d 秒数]
+// both模式在同一进程中运行服务端和客户端 两者各使用-t个事件循环线程
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <future>
+#include <chrono>
+#include <getopt.h>
+#include "../src/tcpserver.hpp"
+#include "../src/sock.hpp"
+#include "../src/log.hpp"
+
+// 延迟直方图 0~63微秒精确计数 之上每个2的幂区间分为32个桶 相对误差不超过1/32
+class LatencyHistogram
+{
+public:
+    LatencyHistogram() : buckets_(BUCKET_COUNT, 0), count_(0), max_(0) {}
+
+    // 记录一次延迟(微秒)
+    void record(uint64_t us)
+    {
+        buckets_[bucket_of(us)]++;
+        count_++;
+        if (us > max_)
+            max_ = us;
+    }
+
+    // 合并另一个直方图
+    void merge(const LatencyHistogram &other)
+    {
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+            buckets_[i] += other.buckets_[i];
+        count_ += other.count_;
+        if (other.max_ > max_)
+            max_ = other.max_;
+    }
+
+    // 百分位数 p取值0~1 返回所在桶的下界
+    uint64_t percentile(double p) const
+    {
+        if (count_ == 0)
+            return 0;
+
+        uint64_t rank = static_cast<uint64_t>(p * count_);
+        if (rank >= count_)
+            rank = count_ - 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_COUNT; i++)
+        {
+            seen += buckets_[i];
+            if (seen > rank)
+                return lower_bound_of(i);
+        }
+        return max_;
+    }
+
+    uint64_t count() const { return count_; } // 记录次数
+    uint64_t max() const { return max_; }     // 最大延迟
+
+private:
+    static const size_t LINEAR = 64;                              // 精确计数的区间
+    static const size_t SUB_BUCKETS = 32;                         // 每个2的幂区间的桶数
+    static const size_t BUCKET_COUNT = LINEAR + 58 * SUB_BUCKETS; // 覆盖到2^64
+
+    static size_t bucket_of(uint64_t us)
+    {
+        if (us < LINEAR)
+            return us;
+        int msb = 63 - __builtin_clzll(us); // 不小于6
+        int shift = msb - 5;                // 保留最高6位 取值32~63
+        return LINEAR + (msb - 6) * SUB_BUCKETS + ((us >> shift) - SUB_BUCKETS);
+    }
+
+    static uint64_t lower_bound_of(size_t bucket)
+    {
+        if (bucket < LINEAR)
+            return bucket;
+        size_t group = (bucket - LINEAR) / SUB_BUCKETS;
+        size_t sub = (bucket - LINEAR) % SUB_BUCKETS;
+        return static_cast<uint64_t>(SUB_BUCKETS + sub) << (group + 1);
+    }
+
+private:
+    std::vector<uint64_t> buckets_; // 各桶计数
+    uint64_t count_;                // 记录次数
+    uint64_t max_;                  // 最大延迟
+};
+
+// 测试参数
+struct Options
+{
+    std::string mode = "both"; // 运行模式 both/server/client
+    int port = 9981;           // 端口
+    int connections = 10;      // 客户端连接数
+    size_t size = 4096;        // 消息字节数
+    int threads = 1;           // 事件循环线程数
+    int seconds = 10;          // 测试时长(秒)
+};
+
+// 每个客户端事件循环的统计 只在该事件循环线程中修改
+struct ClientContext
+{
+    EventLoop *loop = nullptr;                      // 客户端事件循环
+    std::vector<TcpConnectionPtr> conns;            // 本事件循环上的连接
+    std::vector<std::shared_ptr<uint64_t>> sent_at; // 各连接当前消息的发送时间
+    LatencyHistogram histogram;                     // 往返延迟
+    uint64_t bytes = 0;                             // 收到的字节数
+    uint64_t messages = 0;                          // 收到的消息数
+    bool stopped = false;                           // 是否停止发送
+};
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-m both|server|client] [-p port] [-c connections] [-s size] [-t threads] [-d seconds]\n", prog);
+    exit(1);
+}
+
+static Options parse_options(int argc, char *argv[])
+{
+    Options opt;
+    int c;
+    while ((c = getopt(argc, argv, "m:p:c:s:t:d:h")) != -1)
+    {
+        switch (c)
+        {
+        case 'm':
+            opt.mode = optarg;
+            break;
+        case 'p':
+            opt.port = atoi(optarg);
+            break;
+        case 'c':
+            opt.connections = atoi(optarg);
+            break;
+        case 's':
+            opt.size = strtoul(optarg, nullptr, 10);
+            break;
+        case 't':
+            opt.threads = atoi(optarg);
+            break;
+        case 'd':
+            opt.seconds = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if ((opt.mode != "both" && opt.mode != "server" && opt.mode != "client") ||
+        opt.connections <= 0 || opt.size == 0 || opt.threads < 0 || opt.seconds <= 0)
+        usage(argv[0]);
+    return opt;
+}
+
+// 在事件循环线程中执行fn并等待完成
+template <typename Fn>
+static void run_and_wait(EventLoop *loop, Fn fn)
+{
+    std::promise<void> done;
+    loop->run_in_loop([&]()
+                      { fn(); done.set_value(); });
+    done.get_future().wait();
+}
+
+// 阻塞地连接服务器 成功后设置为非阻塞 失败返回-1
+static int connect_server(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+    {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// 客户端负载 建立连接 运行指定时长后汇总并输出结果
+static void run_client(const Options &opt, const std::vector<EventLoop *> &loops)
+{
+    const std::string message(opt.size, 'p');
+    std::vector<ClientContext> contexts(loops.size());
+    for (size_t i = 0; i < loops.size(); i++)
+        contexts[i].loop = loops[i];
+
+    for (int i = 0; i < opt.connections; i++)
+    {
+        int fd = connect_server(opt.port);
+        if (fd == -1)
+        {
+            LOG_FMT(FATAL, "connect to port {} failed! errno={}", opt.port, errno);
+            abort();
+        }
+
+        ClientContext *ctx = &contexts[i % contexts.size()];
+        uint64_t id = i;
+        run_and_wait(ctx->loop, [ctx, fd, id, &opt, &message]()
+                     {
+            TcpConnectionPtr conn = std::make_shared<TcpConnection>(ctx->loop, fd, id);
+            conn->set_tcp_no_delay(true);
+            std::shared_ptr<uint64_t> sent_at = std::make_shared<uint64_t>(0);
+            conn->set_message_callback([ctx, sent_at, &opt, &message](const TcpConnectionPtr &conn, Buffer *buffer)
+                                       {
+                while (buffer->readable_size() >= opt.size)
+                {
+                    buffer->move_read_off(opt.size);
+                    uint64_t now = timer_now();
+                    ctx->histogram.record(now - *sent_at);
+                    ctx->bytes += opt.size;
+                    ctx->messages++;
+                    if (ctx->stopped)
+                        continue;
+                    *sent_at = now;
+                    conn->send(message.data(), message.size());
+                } });
+            conn->set_close_callback([ctx](const TcpConnectionPtr &conn)
+                                     {
+                if (!ctx->stopped)
+                    LOG_FMT(ERROR, "connection {} closed by server", conn->id());
+                conn->owner_loop()->queue_in_loop([conn]()
+                                                  { conn->connect_destroyed(); }); });
+            conn->connect_established();
+            ctx->conns.push_back(conn);
+            ctx->sent_at.push_back(sent_at); });
+    }
+
+    // 所有连接建立后同时开始发送
+    uint64_t start = timer_now();
+    for (ClientContext &ctx : contexts)
+    {
+        ClientContext *c = &ctx;
+        c->loop->run_in_loop([c, &message]()
+                             {
+            for (size_t i = 0; i < c->conns.size(); i++)
+            {
+                *c->sent_at[i] = timer_now();
+                c->conns[i]->send(message.data(), message.size());
+            } });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(opt.seconds));
+
+    // 停止发送并汇总统计 之后关闭连接
+    LatencyHistogram histogram;
+    uint64_t bytes = 0, messages = 0;
+    for (ClientContext &ctx : contexts)
+        run_and_wait(ctx.loop, [&ctx]()
+                     { ctx.stopped = true; });
+    double elapsed = (timer_now() - start) / 1e6;
+    for (ClientContext &ctx : contexts)
+    {
+        run_and_wait(ctx.loop, [&]()
+                     {
+            histogram.merge(ctx.histogram);
+            bytes += ctx.bytes;
+            messages += ctx.messages;
+            for (const TcpConnectionPtr &conn : ctx.conns)
+                conn->connect_destroyed();
+            ctx.conns.clear(); });
+    }
+
+    printf("connections=%d size=%zu threads=%d duration=%.2fs poller=%s\n",
+           opt.connections, opt.size, opt.threads, elapsed, loops.front()->poller_name());
+    printf("throughput: %.2f MiB/s %.0f msgs/s\n", bytes / elapsed / (1024 * 1024), messages / elapsed);
+    printf("latency(us): p50=%lu p99=%lu p999=%lu max=%lu samples=%lu\n",
+           histogram.percentile(0.5), histogram.percentile(0.99), histogram.percentile(0.999),
+           histogram.max(), histogram.count());
+}
+
+int main(int argc, char *argv[])
+{
+    Options opt = parse_options(argc, argv);
+    EventLoop base_loop;
+
+    // 服务端 原样回显收到的数据
+    std::unique_ptr<TcpServer> server;
+    if (opt.mode != "client")
+    {
+        server.reset(new TcpServer(&base_loop, opt.port));
+        server->set_thread_count(opt.threads);
+        server->set_connection_callback([](const TcpConnectionPtr &conn)
+                                        {
+            if (conn->connected())
+                conn->set_tcp_no_delay(true); });
+        server->set_message_callback([](const TcpConnectionPtr &conn, Buffer *buffer)
+                                     { conn->send(buffer); });
+        server->start();
+    }
+
+    if (opt.mode == "server")
+    {
+        base_loop.loop();
+        return 0;
+    }
+
+    // 客户端 在独立线程中建立连接并计时 避免阻塞主事件循环的监听
+    EventLoopThreadPool client_pool(&base_loop);
+    client_pool.set_thread_count(opt.threads);
+    client_pool.start();
+    std::vector<EventLoop *> loops = client_pool.all_loops();
+    std::thread client([&]()
+                       {
+        run_client(opt, loops);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    return 0;
+}
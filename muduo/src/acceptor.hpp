@@ -0,0 +1,147 @@
+#pragma once
+
+#include <functional>
+#include <fcntl.h>
+#include "sock.hpp"
+#include "eventloop.hpp"
+#include "log.hpp"
+
+using accept_callback = std::function<void(int)>; // 新连接回调函数 参数为新连接的描述符
+
+// 监听器 每次可读时循环accept4直到EAGAIN 新连接为非阻塞且设置CLOEXEC
+// 预留一个空闲描述符 描述符耗尽时用它接受并立即关闭新连接 避免监听套接字持续可读导致忙循环
+class Acceptor : private ChannelHandler
+{
+public:
+    // 构造函数 创建监听套接字 reuse_port: 是否开启端口复用 用于多个事件循环各自监听同一端口
+    Acceptor(EventLoop *loop, int port, bool reuse_port = false, const std::string &ip = "0.0.0.0")
+        : loop_(loop), listening_(false), idle_fd_(open_idle_fd()), channel_(loop, create_listen_fd(port, ip, reuse_port))
+    {
+        channel_.set_handler(this);
+    }
+
+    // 构造函数 复制shared的监听套接字 多个事件循环共享同一个监听队列
+    // 以独占唤醒方式监控 每个新连接只唤醒其中一个事件循环
+    Acceptor(EventLoop *loop, const Acceptor &shared)
+        : loop_(loop), listening_(false), idle_fd_(open_idle_fd()), channel_(loop, dup_listen_fd(shared))
+    {
+        channel_.set_handler(this);
+        channel_.enable_exclusive();
+    }
+
+    // 析构函数 必须在所属事件循环线程中析构
+    ~Acceptor()
+    {
+        if (listening_)
+            channel_.remove();
+        if (idle_fd_ != -1)
+            close(idle_fd_);
+    }
+
+    Acceptor(const Acceptor &) = delete;
+    Acceptor &operator=(const Acceptor &) = delete;
+
+    // 设置新连接回调函数 回调负责接管描述符的生命周期
+    void set_accept_callback(const accept_callback &cb) { accept_callback_ = cb; }
+
+    // 开始监听 启动读事件监控
+    void listen()
+    {
+        loop_->assert_in_loop();
+        listening_ = true;
+        channel_.enable_read();
+    }
+
+    // 获取所属事件循环
+    EventLoop *owner_loop() const { return loop_; }
+
+    // 是否正在监听
+    bool listening() const { return listening_; }
+
+    // 监听套接字是否创建成功
+    bool valid() const { return socket_.GetFd() != -1; }
+
+private:
+    // 创建非阻塞的监听套接字
+    int create_listen_fd(int port, const std::string &ip, bool reuse_port)
+    {
+        if (!socket_.CreateServer(port, ip, reuse_port, true))
+            socket_.Close();
+        return socket_.GetFd();
+    }
+
+    // 复制共享的监听套接字
+    int dup_listen_fd(const Acceptor &shared)
+    {
+        socket_.DupFrom(shared.socket_);
+        return socket_.GetFd();
+    }
+
+    // 打开预留的空闲描述符
+    static int open_idle_fd()
+    {
+        int fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        if (fd == -1)
+            LOG_MSG(ERROR, "open idle fd failed!");
+        return fd;
+    }
+
+    // 监听套接字读事件 循环获取新连接直到没有待处理的连接
+    void handle_read() override
+    {
+        while (true)
+        {
+            int saved_errno = 0;
+            int fd = socket_.Accept4(&saved_errno);
+            if (fd != -1)
+            {
+                if (accept_callback_)
+                    accept_callback_(fd);
+                else
+                    close(fd); // 没有接管者则直接关闭
+                continue;
+            }
+
+            switch (saved_errno)
+            {
+            case EAGAIN:
+                return; // 已取完所有连接
+            case EINTR:
+            case ECONNABORTED:
+            case EPROTO:
+            case EPERM:
+                continue; // 单个连接出错 继续获取下一个
+            case EMFILE:
+            case ENFILE:
+                shed_connection();
+                return;
+            default:
+                LOG_FMT(ERROR, "accept socket failed! errno={}", saved_errno);
+                return;
+            }
+        }
+    }
+
+    // 描述符耗尽 释放空闲描述符接受一个连接后立即关闭 再重新占用空闲描述符
+    // 对端会收到连接关闭 而不是留在监听队列中使监听套接字一直可读
+    void shed_connection()
+    {
+        LOG_MSG(WARN, "accept socket failed! too many open files, shedding connection");
+        if (idle_fd_ == -1)
+            return;
+
+        close(idle_fd_);
+        int fd = accept4(socket_.GetFd(), nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd != -1)
+            close(fd);
+        idle_fd_ = open_idle_fd();
+    }
+
+private:
+    EventLoop *loop_;                 // 所属事件循环
+    bool listening_;                  // 是否正在监听
+    int idle_fd_;                     // 预留的空闲描述符
+    Socket socket_;                   // 监听套接字
+    Channel channel_;                 // 监听套接字对应的Channel
+    accept_callback accept_callback_; // 新连接回调函数
+};
@@ -1,31 +1,91 @@
 #pragma once
 
 #include <stdlib.h>
-#include <vector>
 #include <string>
+#include <algorithm>
+#include <string_view>
 #include <string.h>
 #include <cassert>
+#include <cerrno>
+#include <utility>
+#include <endian.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "bufferpool.hpp"
+#include "scanner.hpp"
 #include "log.hpp"
 
-static const size_t BUFFER_DEAULT_SIZE = 1024; // 初始缓冲区大小
+static const size_t BUFFER_DEAULT_SIZE = 1024;      // 初始缓冲区大小
+static const size_t BUFFER_EXTRA_SIZE = 64 * 1024; // 从描述符读取时栈上额外空间大小
+static const size_t BUFFER_PREPEND_SIZE = 8;        // 前沿预留空间大小 用于在数据前补写长度头
 
+// 缓冲区 存储空间的前BUFFER_PREPEND_SIZE字节预留给prepend 写入数据后可在其前补写长度头而无需搬移数据
+// 预留空间包含在容量内 不改变内存池的尺寸等级
 class Buffer
 {
 public:
-    // 构造函数
-    Buffer(size_t init_size = BUFFER_DEAULT_SIZE) : read_index_(0), write_index_(0), buffer_(init_size) {}
+    // 构造函数 pool: 存储空间来源的内存池 为空时直接使用malloc 两种方式都不会对内存清零
+    Buffer(size_t init_size = BUFFER_DEAULT_SIZE, BufferPool *pool = nullptr)
+        : read_index_(0), write_index_(0), buffer_(nullptr), capacity_(0), pool_(pool)
+    {
+        if (init_size > 0)
+        {
+            buffer_ = allocate(std::max(init_size, BUFFER_PREPEND_SIZE * 2), &capacity_);
+            read_index_ = write_index_ = BUFFER_PREPEND_SIZE;
+        }
+    }
+
+    // 析构函数 存储空间归还给内存池
+    ~Buffer() { deallocate(buffer_, capacity_); }
+
+    // 拷贝构造 只拷贝可读数据
+    Buffer(const Buffer &other)
+        : read_index_(0), write_index_(0), buffer_(nullptr), capacity_(0), pool_(other.pool_)
+    {
+        if (other.capacity_ > 0)
+        {
+            buffer_ = allocate(other.capacity_, &capacity_);
+            read_index_ = write_index_ = BUFFER_PREPEND_SIZE;
+        }
+        write(other.buffer_ + other.read_index_, other.readable_size());
+    }
+
+    // 移动构造 接管存储空间
+    Buffer(Buffer &&other) noexcept
+        : read_index_(other.read_index_), write_index_(other.write_index_),
+          buffer_(other.buffer_), capacity_(other.capacity_), pool_(other.pool_)
+    {
+        other.read_index_ = other.write_index_ = other.capacity_ = 0;
+        other.buffer_ = nullptr;
+    }
+
+    Buffer &operator=(Buffer other) noexcept
+    {
+        swap(other);
+        return *this;
+    }
+
+    // 交换两个缓冲区
+    void swap(Buffer &other) noexcept
+    {
+        std::swap(read_index_, other.read_index_);
+        std::swap(write_index_, other.write_index_);
+        std::swap(buffer_, other.buffer_);
+        std::swap(capacity_, other.capacity_);
+        std::swap(pool_, other.pool_);
+    }
 
     // 获取写入地址
-    char *begin_write() { return &buffer_[write_index_]; }
+    char *begin_write() { return buffer_ + write_index_; }
 
     // 获取读取地址
-    char *begin_read() { return &buffer_[read_index_]; }
+    char *begin_read() { return buffer_ + read_index_; }
 
-    // 获取前沿空闲空间大小
+    // 获取前沿空闲空间大小 包括预留空间 即可以prepend的字节数
     size_t head_free_size() const { return read_index_; }
 
     // 获取后沿空闲空间大小
-    size_t back_free_size() const { return buffer_.size() - write_index_; }
+    size_t back_free_size() const { return capacity_ - write_index_; }
 
     // 获取可读数据大小
     size_t readable_size() const { return write_index_ - read_index_; }
@@ -33,6 +93,9 @@ public:
     // 获取可写数据大小
     size_t writeable_size() const { return head_free_size() + back_free_size(); }
 
+    // 获取存储空间大小
+    size_t capacity() const { return capacity_; }
+
     // 读索引前移
     void move_read_off(size_t len)
     {
@@ -53,27 +116,41 @@ public:
         if (back_free_size() >= len)
             // 后沿空闲空间足够直接返回
             return;
-        else if (writeable_size() >= len)
+        else if (writeable_size() >= len + BUFFER_PREPEND_SIZE)
         {
-            // 后沿空闲空间不够，但前后空闲空间总和足够
-            size_t readable = readable_size();                   // 可读数据大小
-            std::copy(begin_read(), begin_write(), &buffer_[0]); // 将数据移到前端
-            read_index_ = 0;                                     // 重置读索引
-            write_index_ = read_index_ + readable;               // 重置写索引
+            // 后沿空闲空间不够，但前后空闲空间总和足够 搬移后仍保留预留空间
+            size_t readable = readable_size();                              // 可读数据大小
+            memmove(buffer_ + BUFFER_PREPEND_SIZE, begin_read(), readable); // 将数据移到前端
+            read_index_ = BUFFER_PREPEND_SIZE;                              // 重置读索引
+            write_index_ = read_index_ + readable;                          // 重置写索引
         }
         else
         {
-            // 前后空闲空间总和不够
-            buffer_.resize(write_index_ + len); // 扩容
+            // 前后空闲空间总和不够 申请新空间并只拷贝可读数据 新空间不清零
+            size_t need = BUFFER_PREPEND_SIZE + readable_size() + len;
+            reallocate(BUFFER_PREPEND_SIZE, need > capacity_ * 2 ? need : capacity_ * 2);
         }
     }
 
+    // 释放存储空间 用于空闲连接归还内存 之后写入时重新申请
+    void release()
+    {
+        assert(readable_size() == 0);
+        deallocate(buffer_, capacity_);
+        buffer_ = nullptr;
+        capacity_ = 0;
+        read_index_ = write_index_ = 0;
+    }
+
     // 写入数据
     void write(const char *data, size_t len)
     {
-        ensure_writeable(len);                      // 确保可写空间足够
-        std::copy(data, data + len, begin_write()); // 写入数据
-        move_write_off(len);                        // 写索引前移
+        if (len == 0)
+            return;
+
+        ensure_writeable(len);            // 确保可写空间足够
+        memcpy(begin_write(), data, len); // 写入数据
+        move_write_off(len);              // 写索引前移
     }
 
     // 写入字符串
@@ -82,12 +159,46 @@ public:
     // 写入缓冲区
     void write_buffer(Buffer &buffer) { write(buffer.begin_read(), buffer.readable_size()); }
 
+    // 在可读数据之前写入数据 用于在已写入的消息体前补写消息头 前沿空间足够时不搬移消息体
+    void prepend(const void *data, size_t len)
+    {
+        if (len > head_free_size())
+            reallocate(len + BUFFER_PREPEND_SIZE, len + BUFFER_PREPEND_SIZE + readable_size() + back_free_size());
+
+        read_index_ -= len;
+        memcpy(begin_read(), data, len);
+    }
+
+    // 以网络字节序写入整数
+    void write_uint8(uint8_t value) { write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+    void write_uint16(uint16_t value) { value = htobe16(value); write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+    void write_uint32(uint32_t value) { value = htobe32(value); write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+    void write_uint64(uint64_t value) { value = htobe64(value); write(reinterpret_cast<const char *>(&value), sizeof(value)); }
+
+    // 以网络字节序在可读数据之前写入整数
+    void prepend_uint8(uint8_t value) { prepend(&value, sizeof(value)); }
+    void prepend_uint16(uint16_t value) { value = htobe16(value); prepend(&value, sizeof(value)); }
+    void prepend_uint32(uint32_t value) { value = htobe32(value); prepend(&value, sizeof(value)); }
+    void prepend_uint64(uint64_t value) { value = htobe64(value); prepend(&value, sizeof(value)); }
+
+    // 查看网络字节序的整数 不移动读索引 可读数据需足够
+    uint8_t peek_uint8() { return static_cast<uint8_t>(*peek_bytes(sizeof(uint8_t))); }
+    uint16_t peek_uint16() { uint16_t value; memcpy(&value, peek_bytes(sizeof(value)), sizeof(value)); return be16toh(value); }
+    uint32_t peek_uint32() { uint32_t value; memcpy(&value, peek_bytes(sizeof(value)), sizeof(value)); return be32toh(value); }
+    uint64_t peek_uint64() { uint64_t value; memcpy(&value, peek_bytes(sizeof(value)), sizeof(value)); return be64toh(value); }
+
+    // 读取网络字节序的整数 可读数据需足够
+    uint8_t read_uint8() { uint8_t value = peek_uint8(); move_read_off(sizeof(value)); return value; }
+    uint16_t read_uint16() { uint16_t value = peek_uint16(); move_read_off(sizeof(value)); return value; }
+    uint32_t read_uint32() { uint32_t value = peek_uint32(); move_read_off(sizeof(value)); return value; }
+    uint64_t read_uint64() { uint64_t value = peek_uint64(); move_read_off(sizeof(value)); return value; }
+
     // 读取数据
     void read(char *data, size_t len)
     {
-        assert(len <= readable_size());                    // 确保可读数据足够
-        std::copy(begin_read(), begin_read() + len, data); // 读取数据
-        move_read_off(len);                                // 读索引前移
+        assert(len <= readable_size());  // 确保可读数据足够
+        memcpy(data, begin_read(), len); // 读取数据
+        move_read_off(len);              // 读索引前移
     }
 
     // 读取字符串
@@ -99,11 +210,38 @@ public:
         return data;
     }
 
-    // 查找CRLF
+    // 查找CRLF 返回行尾换行符的位置 同时兼容只有LF的行
     char *find_crlf()
     {
-        void *ret = memchr(begin_read(), '\n', readable_size()); // 查找换行符
-        return static_cast<char *>(ret);                         // 返回查找结果
+        char *end = begin_write();
+        char *ret = const_cast<char *>(scan_char(begin_read(), end, '\n')); // 向量化查找换行符
+        return ret == end ? nullptr : ret;                                  // 返回查找结果
+    }
+
+    // 查找分隔符集合中任意一个字符 未找到返回nullptr
+    char *find_delim(const DelimiterSet &delims)
+    {
+        char *end = begin_write();
+        char *ret = const_cast<char *>(scan_any(begin_read(), end, delims));
+        return ret == end ? nullptr : ret;
+    }
+
+    // 查看行数据 不拷贝也不移动读索引 返回的视图不含行尾的CRLF或LF 未找到换行符返回空视图
+    // 视图在缓冲区被修改前有效 处理完毕后调用move_read_off(line_size)丢弃该行
+    std::string_view peek_line(size_t *line_size)
+    {
+        char *crlf = find_crlf(); // 查找换行符
+        if (crlf == nullptr)
+        {
+            *line_size = 0;
+            return std::string_view();
+        }
+
+        *line_size = crlf - begin_read() + 1;
+        size_t len = *line_size - 1;
+        if (len > 0 && crlf[-1] == '\r')
+            len--; // 去掉回车符
+        return std::string_view(begin_read(), len);
     }
 
     // 读取行数据
@@ -116,15 +254,117 @@ public:
         return ""; // 未找到换行符返回空字符串
     }
 
+    // 从描述符读取数据 返回读取的字节数 出错时返回-1并将errno保存到saved_errno
+    // 使用readv同时读入后沿空闲空间和栈上的额外空间 一次系统调用即可读空套接字
+    // 空闲缓冲区无需预先扩容 只有超出后沿空闲空间的部分才会追加到缓冲区中
+    ssize_t read_from_fd(int fd, int *saved_errno)
+    {
+        char extra[BUFFER_EXTRA_SIZE]; // 栈上额外空间
+        size_t writeable = back_free_size();
+
+        struct iovec vec[2];
+        vec[0].iov_base = begin_write();
+        vec[0].iov_len = writeable;
+        vec[1].iov_base = extra;
+        vec[1].iov_len = sizeof(extra);
+
+        // 后沿空闲空间已足够大时不使用额外空间 避免单次读取过多数据
+        int iovcnt = writeable < sizeof(extra) ? 2 : 1;
+        ssize_t n = readv(fd, vec, iovcnt);
+        if (n < 0)
+        {
+            *saved_errno = errno;
+            return n;
+        }
+
+        if (static_cast<size_t>(n) <= writeable)
+        {
+            move_write_off(n); // 数据全部读入后沿空闲空间
+        }
+        else
+        {
+            move_write_off(writeable);   // 后沿空闲空间已写满
+            write(extra, n - writeable); // 只追加溢出部分
+        }
+        return n;
+    }
+
+    // 将可读数据写入描述符 返回写入的字节数 出错时返回-1并将errno保存到saved_errno
+    ssize_t write_to_fd(int fd, int *saved_errno)
+    {
+        ssize_t n = ::write(fd, begin_read(), readable_size());
+        if (n < 0)
+        {
+            *saved_errno = errno;
+            return n;
+        }
+
+        move_read_off(n); // 读索引前移
+        return n;
+    }
+
     // 清空缓冲区
     void clear()
     {
-        read_index_ = 0;
-        write_index_ = 0;
+        read_index_ = buffer_ ? BUFFER_PREPEND_SIZE : 0;
+        write_index_ = read_index_;
+    }
+
+private:
+    // 可读数据的起始地址 可读数据不少于len字节
+    char *peek_bytes(size_t len)
+    {
+        assert(len <= readable_size());
+        return begin_read();
+    }
+
+    // 申请至少size字节的新空间 可读数据拷贝到front偏移处 新空间不清零
+    void reallocate(size_t front, size_t size)
+    {
+        size_t readable = readable_size();
+        size_t capacity = 0;
+        char *buffer = allocate(size, &capacity);
+        if (readable > 0)
+            memcpy(buffer + front, begin_read(), readable);
+        deallocate(buffer_, capacity_);
+        buffer_ = buffer;
+        capacity_ = capacity;
+        read_index_ = front;
+        write_index_ = front + readable;
+    }
+
+    // 申请存储空间 实际大小写入capacity
+    char *allocate(size_t size, size_t *capacity)
+    {
+        if (pool_)
+        {
+            *capacity = BufferPool::round_up(size);
+            return pool_->allocate(size);
+        }
+
+        *capacity = size;
+        char *mem = static_cast<char *>(malloc(size));
+        if (mem == nullptr)
+        {
+            LOG_MSG(FATAL, "buffer allocate failed!");
+            abort();
+        }
+        return mem;
+    }
+
+    // 释放存储空间
+    void deallocate(char *mem, size_t capacity)
+    {
+        if (pool_)
+            pool_->deallocate(mem, capacity);
+        else
+            free(mem);
     }
 
 private:
-    size_t read_index_;        // 读索引
-    size_t write_index_;       // 写索引
-    std::vector<char> buffer_; // 缓冲区
+    size_t read_index_;  // 读索引
+    size_t write_index_; // 写索引
+    char *buffer_;       // 缓冲区
+    size_t capacity_;    // 缓冲区大小
+    BufferPool *pool_;   // 存储空间来源的内存池
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <cstdint>
+#include <cassert>
+#include "log.hpp"
+
+static const size_t BUFFER_POOL_MIN_CLASS = 1024;              // 最小尺寸等级 1K
+static const int BUFFER_POOL_CLASS_COUNT = 6;                  // 尺寸等级数量 1K 4K 16K 64K 256K 1M
+static const size_t BUFFER_POOL_CLASS_CACHE = 8 * 1024 * 1024; // 每个尺寸等级最多缓存的字节数
+
+// 内存池统计信息 计数器为宽松原子变量 可在其他线程读取
+struct BufferPoolStats
+{
+    std::atomic<uint64_t> hits{0};         // 从空闲链表中分配的次数
+    std::atomic<uint64_t> misses{0};       // 向malloc申请的次数
+    std::atomic<uint64_t> oversize{0};     // 超过最大尺寸等级直接向malloc申请的次数
+    std::atomic<uint64_t> in_use_bytes{0}; // 已分配出去的字节数
+    std::atomic<uint64_t> cached_bytes{0}; // 空闲链表中缓存的字节数
+};
+
+// 按尺寸等级管理的缓冲区内存池 每个事件循环持有一个 只能在所属线程中使用
+// 分配的内存不做初始化 释放时挂回对应尺寸等级的空闲链表 供后续连接复用
+class BufferPool
+{
+public:
+    BufferPool(size_t class_cache = BUFFER_POOL_CLASS_CACHE) : class_cache_(class_cache)
+    {
+        for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++)
+        {
+            free_lists_[i] = nullptr;
+            free_bytes_[i] = 0;
+        }
+    }
+
+    // 析构函数 释放所有缓存的内存
+    ~BufferPool()
+    {
+        for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++)
+        {
+            while (free_lists_[i])
+            {
+                FreeNode *node = free_lists_[i];
+                free_lists_[i] = node->next;
+                free(node);
+            }
+        }
+    }
+
+    BufferPool(const BufferPool &) = delete;
+    BufferPool &operator=(const BufferPool &) = delete;
+
+    // 计算size对应的实际分配大小 超过最大尺寸等级时按原大小分配
+    static size_t round_up(size_t size)
+    {
+        int index = class_index(size);
+        return index < 0 ? size : class_size(index);
+    }
+
+    // 分配至少size字节的内存 实际大小为round_up(size) 内存内容未初始化
+    char *allocate(size_t size)
+    {
+        int index = class_index(size);
+        size_t capacity = index < 0 ? size : class_size(index);
+        stats_.in_use_bytes.fetch_add(capacity, std::memory_order_relaxed);
+
+        if (index >= 0 && free_lists_[index])
+        {
+            // 命中空闲链表
+            FreeNode *node = free_lists_[index];
+            free_lists_[index] = node->next;
+            free_bytes_[index] -= capacity;
+            stats_.cached_bytes.fetch_sub(capacity, std::memory_order_relaxed);
+            stats_.hits.fetch_add(1, std::memory_order_relaxed);
+            return reinterpret_cast<char *>(node);
+        }
+
+        if (index < 0)
+            stats_.oversize.fetch_add(1, std::memory_order_relaxed);
+        stats_.misses.fetch_add(1, std::memory_order_relaxed);
+
+        char *mem = static_cast<char *>(malloc(capacity));
+        if (mem == nullptr)
+        {
+            LOG_MSG(FATAL, "buffer pool allocate failed!");
+            abort();
+        }
+        return mem;
+    }
+
+    // 归还内存 capacity必须为allocate时的实际分配大小
+    void deallocate(char *mem, size_t capacity)
+    {
+        if (mem == nullptr)
+            return;
+
+        stats_.in_use_bytes.fetch_sub(capacity, std::memory_order_relaxed);
+        int index = class_index(capacity);
+        if (index < 0 || class_size(index) != capacity || free_bytes_[index] + capacity > class_cache_)
+        {
+            // 超大内存或缓存已满时直接归还给malloc 避免内存池无限膨胀
+            free(mem);
+            return;
+        }
+
+        FreeNode *node = reinterpret_cast<FreeNode *>(mem);
+        node->next = free_lists_[index];
+        free_lists_[index] = node;
+        free_bytes_[index] += capacity;
+        stats_.cached_bytes.fetch_add(capacity, std::memory_order_relaxed);
+    }
+
+    // 获取统计信息
+    const BufferPoolStats &stats() const { return stats_; }
+
+private:
+    // 空闲链表节点 直接复用空闲内存本身存放next指针
+    struct FreeNode
+    {
+        FreeNode *next;
+    };
+
+    // 尺寸等级对应的大小 每级为上一级的4倍
+    static size_t class_size(int index) { return BUFFER_POOL_MIN_CLASS << (2 * index); }
+
+    // size所属的尺寸等级 超过最大尺寸等级返回-1
+    static int class_index(size_t size)
+    {
+        for (int i = 0; i < BUFFER_POOL_CLASS_COUNT; i++)
+        {
+            if (size <= class_size(i))
+                return i;
+        }
+        return -1;
+    }
+
+private:
+    size_t class_cache_;                            // 每个尺寸等级最多缓存的字节数
+    FreeNode *free_lists_[BUFFER_POOL_CLASS_COUNT]; // 各尺寸等级的空闲链表
+    size_t free_bytes_[BUFFER_POOL_CLASS_COUNT];    // 各尺寸等级缓存的字节数
+    BufferPoolStats stats_;                         // 统计信息
+};
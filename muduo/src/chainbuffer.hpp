@@ -0,0 +1,533 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <utility>
+#include <atomic>
+#include <new>
+#include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include "log.hpp"
+
+static const size_t CHAIN_BLOCK_SIZE = 16 * 1024;         // 数据块默认容量
+static const int CHAIN_MAX_IOV = IOV_MAX;                 // 单次writev最多发送的数据块数量
+static const size_t CHAIN_ZEROCOPY_THRESHOLD = 16 * 1024; // 零拷贝发送的最小数据量 更小的数据拷贝发送更快
+
+// 引用计数的数据块 块头与数据一次分配 数据区紧跟在块头之后
+// 已写入的数据一旦被多处引用就不再修改 因此可在多个连接 多个线程之间共享
+class ChainBlock
+{
+public:
+    // 创建数据块 初始引用计数为1
+    static ChainBlock *create(size_t capacity = CHAIN_BLOCK_SIZE)
+    {
+        void *mem = ::operator new(sizeof(ChainBlock) + capacity);
+        return new (mem) ChainBlock(capacity);
+    }
+
+    char *data() { return reinterpret_cast<char *>(this + 1); } // 数据区起始地址
+    size_t capacity() const { return capacity_; }              // 数据区容量
+    size_t size() const { return size_; }                      // 已写入数据大小
+    size_t free_size() const { return capacity_ - size_; }     // 剩余可写空间
+    int use_count() const { return refs_.load(std::memory_order_acquire); }
+
+    // 在已写入数据之后追加数据 仅允许唯一持有者调用
+    size_t append(const char *data, size_t len)
+    {
+        size_t n = len < free_size() ? len : free_size();
+        memcpy(this->data() + size_, data, n);
+        size_ += n;
+        return n;
+    }
+
+    void ref() { refs_.fetch_add(1, std::memory_order_relaxed); } // 增加引用
+
+    // 减少引用 引用计数归零时释放数据块
+    void unref()
+    {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            this->~ChainBlock();
+            ::operator delete(this);
+        }
+    }
+
+private:
+    ChainBlock(size_t capacity) : refs_(1), capacity_(capacity), size_(0) {}
+
+private:
+    std::atomic<int> refs_; // 引用计数
+    size_t capacity_;       // 数据区容量
+    size_t size_;           // 已写入数据大小
+};
+
+// 数据块引用 拷贝时增加引用计数 析构时减少引用计数
+class BlockRef
+{
+public:
+    BlockRef() : block_(nullptr) {}
+    explicit BlockRef(ChainBlock *block) : block_(block) {} // 接管一个已有引用
+    BlockRef(const BlockRef &other) : block_(other.block_)
+    {
+        if (block_)
+            block_->ref();
+    }
+    BlockRef(BlockRef &&other) noexcept : block_(other.block_) { other.block_ = nullptr; }
+    ~BlockRef() { reset(); }
+
+    BlockRef &operator=(BlockRef other) noexcept
+    {
+        std::swap(block_, other.block_);
+        return *this;
+    }
+
+    // 释放引用
+    void reset()
+    {
+        if (block_)
+            block_->unref();
+        block_ = nullptr;
+    }
+
+    ChainBlock *get() const { return block_; }
+    ChainBlock *operator->() const { return block_; }
+    explicit operator bool() const { return block_ != nullptr; }
+
+private:
+    ChainBlock *block_; // 引用的数据块
+};
+
+// 文件数据来源 持有调用者描述符的副本 数据段发送完毕后关闭
+// 普通文件使用sendfile按偏移发送 管道等不可定位的来源经由中转管道splice发送
+class FileSource
+{
+public:
+    FileSource(int fd, bool seekable) : fd_(fd), seekable_(seekable), pipe_{-1, -1}, piped_(0), starved_(false) {}
+
+    ~FileSource()
+    {
+        close(fd_);
+        if (pipe_[0] != -1)
+        {
+            close(pipe_[0]);
+            close(pipe_[1]);
+        }
+    }
+
+    FileSource(const FileSource &) = delete;
+    FileSource &operator=(const FileSource &) = delete;
+
+    int fd() const { return fd_; }
+    bool seekable() const { return seekable_; }
+    bool starved() const { return starved_; } // 上次发送时来源暂无数据 需等待来源可读而不是out_fd可写
+
+    // 发送offset处的len字节到out_fd 返回发送的字节数 出错返回-1并保存errno
+    // 来源已无数据时返回-1且saved_errno为0 来源暂无数据时返回-1且saved_errno为EAGAIN 同时starved()为true
+    ssize_t send_to(int out_fd, size_t offset, size_t len, int *saved_errno)
+    {
+        if (seekable_)
+        {
+            off_t off = static_cast<off_t>(offset);
+            ssize_t n = sendfile(out_fd, fd_, &off, len);
+            if (n > 0)
+                return n;
+            *saved_errno = n == 0 ? 0 : errno; // 返回0说明文件被截断
+            return -1;
+        }
+        return splice_to(out_fd, len, saved_errno);
+    }
+
+private:
+    // 先把来源数据splice进中转管道 再从管道splice到out_fd 数据不经过用户态
+    // 已进入管道但未发出的字节数记录在piped_中 下次发送时优先发出
+    ssize_t splice_to(int out_fd, size_t len, int *saved_errno)
+    {
+        if (pipe_[0] == -1 && pipe2(pipe_, O_NONBLOCK | O_CLOEXEC) == -1)
+        {
+            *saved_errno = errno;
+            return -1;
+        }
+
+        starved_ = false;
+        if (piped_ < len)
+        {
+            ssize_t n = splice(fd_, nullptr, pipe_[1], nullptr, len - piped_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+            if (n > 0)
+                piped_ += n;
+            else if (piped_ == 0)
+            {
+                // 中转管道为空且来源暂无数据 此时目标描述符可能仍然可写
+                *saved_errno = n == 0 ? 0 : errno;
+                starved_ = *saved_errno == EAGAIN;
+                return -1;
+            }
+        }
+
+        ssize_t n = splice(pipe_[0], nullptr, out_fd, nullptr, piped_, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0)
+        {
+            *saved_errno = errno;
+            return -1;
+        }
+        piped_ -= n;
+        return n;
+    }
+
+private:
+    int fd_;        // 来源描述符的副本
+    bool seekable_; // 是否为可按偏移读取的普通文件
+    int pipe_[2];   // 中转管道 首次splice时创建
+    size_t piped_;  // 已进入中转管道尚未发出的字节数
+    bool starved_;  // 上次从来源splice时是否因来源暂无数据而失败
+};
+
+// 数据块中的一段数据 或文件中的一段数据
+struct BlockSlice
+{
+    BlockRef block;                   // 所属数据块 文件数据段为空
+    size_t offset;                    // 在数据块或文件中的起始偏移
+    size_t len;                       // 数据长度
+    std::shared_ptr<FileSource> file; // 文件数据段的来源 内存数据段为空
+
+    char *data() const { return block->data() + offset; }
+};
+
+// 分块链式输出缓冲区 追加数据从不移动已有数据 发送时一次writev发送多个数据块
+// 数据块可被多个缓冲区共享 广播同一份数据时只增加引用计数而不拷贝
+// 也可以追加文件数据段 发送时由内核直接从文件拷贝到套接字
+class ChainBuffer
+{
+public:
+    ChainBuffer(size_t block_size = CHAIN_BLOCK_SIZE)
+        : block_size_(block_size), readable_(0), zerocopy_(false), zerocopy_seq_(0), zerocopy_copied_(0) {}
+
+    size_t readable_size() const { return readable_; }    // 可读数据大小
+    bool empty() const { return readable_ == 0; }         // 是否为空
+    size_t slice_count() const { return slices_.size(); } // 数据段数量
+
+    // 追加数据 优先写入尾部数据块的剩余空间 不足时申请新的定长数据块
+    void write(const char *data, size_t len)
+    {
+        while (len > 0)
+        {
+            if (!tail_writeable())
+                slices_.push_back(BlockSlice{BlockRef(ChainBlock::create(block_size_)), 0, 0, nullptr});
+
+            BlockSlice &tail = slices_.back();
+            size_t n = tail.block->append(data, len);
+            tail.len += n;
+            readable_ += n;
+            data += n;
+            len -= n;
+        }
+    }
+
+    // 追加字符串
+    void write_string(const std::string &data) { write(data.c_str(), data.size()); }
+
+    // 零拷贝追加数据块中的一段数据 只增加数据块的引用计数
+    void append_slice(const BlockRef &block, size_t offset, size_t len)
+    {
+        assert(offset + len <= block->size());
+        if (len == 0)
+            return;
+        slices_.push_back(BlockSlice{block, offset, len, nullptr});
+        readable_ += len;
+    }
+
+    // 零拷贝追加另一个缓冲区中的全部数据 两个缓冲区此后共享相同的数据块
+    // 普通文件数据段同样共享 不可定位的来源只能被读取一次 不能共享
+    void append_chain(const ChainBuffer &other)
+    {
+        for (const BlockSlice &slice : other.slices_)
+        {
+            if (slice.file)
+            {
+                assert(slice.file->seekable());
+                slices_.push_back(slice);
+                readable_ += slice.len;
+                continue;
+            }
+            append_slice(slice.block, slice.offset, slice.len);
+        }
+    }
+
+    // 追加描述符fd中从offset开始的len字节 发送时不拷贝到用户态 与前后的内存数据保持顺序
+    // 普通文件使用sendfile 管道等来源使用splice 此时忽略offset
+    // 内部复制一份描述符 调用者可以立即关闭fd 复制失败返回false
+    bool append_file(int fd, off_t offset, size_t len)
+    {
+        if (len == 0)
+            return true;
+
+        struct stat st;
+        if (fstat(fd, &st) == -1)
+        {
+            LOG_MSG(ERROR, "fstat file failed!");
+            return false;
+        }
+
+        int dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dup_fd == -1)
+        {
+            LOG_MSG(ERROR, "dup file failed!");
+            return false;
+        }
+
+        std::shared_ptr<FileSource> file(new FileSource(dup_fd, S_ISREG(st.st_mode)));
+        slices_.push_back(BlockSlice{BlockRef(), static_cast<size_t>(offset), len, std::move(file)});
+        readable_ += len;
+        return true;
+    }
+
+    // 丢弃前len字节数据 数据块引用计数归零时自动释放
+    void consume(size_t len)
+    {
+        assert(len <= readable_);
+        readable_ -= len;
+        while (len > 0)
+        {
+            BlockSlice &front = slices_.front();
+            if (len < front.len)
+            {
+                front.offset += len;
+                front.len -= len;
+                return;
+            }
+            len -= front.len;
+            slices_.pop_front();
+        }
+    }
+
+    // 将可读数据写入套接字 单次sendmsg最多发送CHAIN_MAX_IOV个内存数据段 遇到文件数据段时停止
+    // 带MSG_NOSIGNAL发送 对端已重置时返回EPIPE而不是以SIGPIPE终止进程
+    // 头部为文件数据段时使用sendfile或splice发送该数据段
+    // 返回写入的字节数 出错时返回-1并将errno保存到saved_errno 部分写入和EAGAIN由调用者等待可写后重试
+    ssize_t write_to_fd(int fd, int *saved_errno)
+    {
+        if (!slices_.empty() && slices_.front().file)
+            return write_file_to_fd(fd, saved_errno);
+
+        struct iovec iov[CHAIN_MAX_IOV];
+        int iovcnt = 0;
+        size_t bytes = 0;
+        for (auto it = slices_.begin(); it != slices_.end() && !it->file && iovcnt < CHAIN_MAX_IOV; ++it, ++iovcnt)
+        {
+            iov[iovcnt].iov_base = it->data();
+            iov[iovcnt].iov_len = it->len;
+            bytes += it->len;
+        }
+
+        if (iovcnt == 0)
+            return 0;
+
+        if (zerocopy_ && bytes >= CHAIN_ZEROCOPY_THRESHOLD)
+        {
+            ssize_t n = write_zerocopy(fd, iov, iovcnt, saved_errno);
+            if (n != -1 || *saved_errno != ENOBUFS)
+                return n;
+            // 内核锁定内存的配额不足 本次改为拷贝发送
+        }
+
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            *saved_errno = errno;
+            return n;
+        }
+
+        consume(n);
+        return n;
+    }
+
+    // 对套接字fd开启MSG_ZEROCOPY零拷贝发送 大于CHAIN_ZEROCOPY_THRESHOLD的数据不再拷贝到内核
+    // 发送后的数据块由内核直接引用 需在描述符可读错误队列时调用reap_zerocopy 收到完成通知后才释放
+    // 内核不支持时返回false 继续使用拷贝发送
+    bool enable_zerocopy(int fd)
+    {
+        int opt = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt)) == -1)
+        {
+            LOG_MSG(WARN, "set zerocopy failed! fallback to copy");
+            return false;
+        }
+        zerocopy_ = true;
+        return true;
+    }
+
+    // 读取fd错误队列中的零拷贝完成通知 释放内核已不再引用的数据块 返回完成的发送次数
+    // 内核报告数据实际被拷贝时(如回环地址)零拷贝没有收益 此后自动改回拷贝发送
+    size_t reap_zerocopy(int fd)
+    {
+        size_t completed = 0;
+        while (!zerocopy_pending_.empty())
+        {
+            char control[CMSG_SPACE(sizeof(struct sock_extended_err)) + CMSG_SPACE(sizeof(struct sockaddr_in6))];
+            struct msghdr msg = {};
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1)
+                break; // 错误队列已读空
+
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg))
+            {
+                bool recverr = (cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+                               (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR);
+                if (!recverr)
+                    continue;
+
+                struct sock_extended_err err;
+                memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+                if (err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0)
+                    continue;
+
+                // [ee_info, ee_data]区间内的发送已完成 序号按32位回绕比较
+                if (err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                {
+                    zerocopy_copied_++;
+                    zerocopy_ = false;
+                }
+                while (!zerocopy_pending_.empty() && static_cast<int32_t>(zerocopy_pending_.front().seq - err.ee_data) <= 0)
+                {
+                    zerocopy_pending_.pop_front();
+                    completed++;
+                }
+            }
+        }
+        return completed;
+    }
+
+    // 头部文件数据段的来源暂无数据时返回其描述符 否则返回-1
+    // write_to_fd返回EAGAIN时据此区分 应等待该描述符可读 而不是等待目标描述符可写
+    int starved_source_fd() const
+    {
+        if (slices_.empty() || !slices_.front().file || !slices_.front().file->starved())
+            return -1;
+        return slices_.front().file->fd();
+    }
+
+    bool zerocopy_enabled() const { return zerocopy_; }                  // 是否使用零拷贝发送
+    size_t zerocopy_pending() const { return zerocopy_pending_.size(); } // 等待完成通知的发送次数
+    uint64_t zerocopy_copied() const { return zerocopy_copied_; }        // 内核报告实际发生拷贝的次数
+
+    // 清空缓冲区
+    void clear()
+    {
+        slices_.clear();
+        readable_ = 0;
+    }
+
+    // 拷贝出全部可读数据 主要用于调试和测试 普通文件数据段通过pread读取 不可定位的来源被跳过
+    std::string to_string() const
+    {
+        std::string data;
+        data.reserve(readable_);
+        for (const BlockSlice &slice : slices_)
+        {
+            if (!slice.file)
+            {
+                data.append(slice.data(), slice.len);
+                continue;
+            }
+
+            if (!slice.file->seekable())
+                continue;
+            size_t begin = data.size();
+            data.resize(begin + slice.len);
+            ssize_t n = pread(slice.file->fd(), &data[begin], slice.len, static_cast<off_t>(slice.offset));
+            data.resize(begin + (n > 0 ? n : 0));
+        }
+        return data;
+    }
+
+private:
+    // 零拷贝发送的数据及其数据块引用 收到完成通知前数据块不会被释放
+    struct ZeroCopySend
+    {
+        uint32_t seq;                 // 内核为每次零拷贝发送分配的序号
+        std::vector<BlockRef> blocks; // 被内核引用的数据块
+    };
+
+    // 以MSG_ZEROCOPY发送iov
+    ssize_t write_zerocopy(int fd, struct iovec *iov, int iovcnt, int *saved_errno)
+    {
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        ssize_t n = sendmsg(fd, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            *saved_errno = errno;
+            return n;
+        }
+
+        // 内核为每次成功的零拷贝发送递增序号 保留已发送部分的数据块引用直到完成通知到达
+        ZeroCopySend send{zerocopy_seq_++, {}};
+        size_t pinned = 0;
+        for (auto it = slices_.begin(); it != slices_.end() && pinned < static_cast<size_t>(n); ++it)
+        {
+            send.blocks.push_back(it->block);
+            pinned += it->len;
+        }
+        zerocopy_pending_.push_back(std::move(send));
+
+        consume(n);
+        return n;
+    }
+
+    // 发送头部的文件数据段
+    ssize_t write_file_to_fd(int fd, int *saved_errno)
+    {
+        BlockSlice &front = slices_.front();
+        ssize_t n = front.file->send_to(fd, front.offset, front.len, saved_errno);
+        if (n < 0)
+        {
+            if (*saved_errno == 0)
+            {
+                // 文件被截断或来源提前结束 丢弃无法发送的剩余部分 继续发送后面的数据
+                LOG_MSG(WARN, "file source ended before expected length!");
+                readable_ -= front.len;
+                slices_.pop_front();
+                return write_to_fd(fd, saved_errno);
+            }
+            return n;
+        }
+
+        consume(n);
+        return n;
+    }
+
+    // 尾部数据块能否继续追加 数据段必须位于数据块末尾 且数据块未被共享
+    bool tail_writeable() const
+    {
+        if (slices_.empty() || slices_.back().file)
+            return false;
+
+        const BlockSlice &tail = slices_.back();
+        return tail.block->free_size() > 0 && tail.offset + tail.len == tail.block->size() && tail.block->use_count() == 1;
+    }
+
+private:
+    size_t block_size_;                         // 新数据块的容量
+    size_t readable_;                           // 可读数据大小
+    std::deque<BlockSlice> slices_;             // 数据段链表
+    bool zerocopy_;                             // 是否使用零拷贝发送
+    uint32_t zerocopy_seq_;                     // 下一次零拷贝发送的序号
+    uint64_t zerocopy_copied_;                  // 内核报告实际发生拷贝的次数
+    std::deque<ZeroCopySend> zerocopy_pending_; // 等待完成通知的零拷贝发送
+};
@@ -1,78 +1,139 @@
+#pragma once
+
 #include <functional>
 #include <sys/epoll.h>
 #include "log.hpp"
 
 using event_callback = std::function<void()>; // 事件回调函数
 
+class EventLoop;
+
+// 事件处理接口 拥有描述符的对象实现需要的方法 Channel只保存一个指向它的指针
+// 相比每个Channel保存多个std::function 每个描述符只占一个指针 分发只有一次虚函数调用
+class ChannelHandler
+{
+public:
+    virtual ~ChannelHandler() = default;
+
+    virtual void handle_read() {}      // 读事件
+    virtual void handle_write() {}     // 写事件
+    virtual void handle_error() {}     // 错误事件
+    virtual void handle_close() {}     // 关闭事件
+    virtual void handle_any_event() {} // 任意事件 每次读写事件处理完毕后调用一次 用于刷新活跃度
+};
+
 class Channel
 {
 public:
-    Channel(int fd) : fd_(fd), events_(0), revents_(0) {} //  构造函数
-    int fd() const { return fd_; }                        // 获取文件描述符
+    Channel(EventLoop *loop, int fd) : fd_(fd), events_(0), revents_(0), loop_(loop), handler_(nullptr) {} //  构造函数
+    int fd() const { return fd_; }                                                                      // 获取文件描述符
+    uint32_t events() const { return events_; }                                                         // 获取当前监控事件
+    EventLoop *owner_loop() const { return loop_; }                                                     // 获取所属事件循环
 
     void set_revents(uint32_t revents) { revents_ = revents; } // 设置触发事件
 
-    void set_read_callback(const event_callback &cb) { read_callback_ = cb; }   // 设置读事件回调函数
-    void set_write_callback(const event_callback &cb) { write_callback_ = cb; } // 设置写事件回调函数
-    void set_error_callback(const event_callback &cb) { error_callback_ = cb; } // 设置错误事件回调函数
-    void set_close_callback(const event_callback &cb) { close_callback_ = cb; } // 设置关闭事件回调函数
-    void set_event_callback(const event_callback &cb) { event_callback_ = cb; } // 设置任意事件回调函数
+    void set_handler(ChannelHandler *handler) { handler_ = handler; } // 设置事件处理对象 生命周期由调用者保证
 
     bool read_enabled() const { return events_ & EPOLLIN; }   // 读事件是否开启
     bool write_enabled() const { return events_ & EPOLLOUT; } // 写事件是否开启
+    bool et_enabled() const { return events_ & EPOLLET; }     // 是否为边缘触发
+
+    void enable_read() { events_ |= EPOLLIN; update(); }   // 开启读事件
+    void enable_write() { events_ |= EPOLLOUT; update(); } // 开启写事件
+
+    void disable_read() { events_ &= ~EPOLLIN; update(); }   // 关闭读事件
+    void disable_write() { events_ &= ~EPOLLOUT; update(); } // 关闭写事件
+    void disable_all() { events_ = 0; update(); }            // 关闭所有事件
+
+    // 开启边缘触发 需在enable_read/enable_write之前调用 回调中需循环读写直到EAGAIN
+    void enable_et() { events_ |= EPOLLET; }
 
-    void enable_read() { events_ |= EPOLLIN; }   // 开启读事件
-    void enable_write() { events_ |= EPOLLOUT; } // 开启写事件
+    // 开启独占唤醒 多个epoll监控同一描述符时事件只唤醒其中一个 用于共享的监听套接字
+    // 需在enable_read之前调用 Poller修改事件时会先删除再重新添加
+    void enable_exclusive() { events_ |= EPOLLEXCLUSIVE; }
 
-    void disable_read() { events_ &= ~EPOLLIN; }   // 关闭读事件
-    void disable_write() { events_ &= ~EPOLLOUT; } // 关闭写事件
-    void disable_all() { events_ = 0; }            // 关闭所有事件
+    // 将当前监控事件同步到所属事件循环的Poller中
+    void update();
 
-    // 处理事件
+    // 从所属事件循环的Poller中移除监控
+    void remove();
+
+    // 处理事件 每个就绪事件对应的方法只调用一次
     void handle_event()
     {
+        if (handler_ == nullptr)
+            return;
+
+        uint32_t revents = revents_;
+        bool handled = false;
+
         // EPOLLIN: 有数据可读 | EPOLLRDHUP: 对端关闭连接 | EPOLLPRI: 有紧急数据可读
-        if ((revents_ & EPOLLIN) || (revents_ & EPOLLRDHUP) || (revents_ & EPOLLPRI))
+        if (revents & (EPOLLIN | EPOLLRDHUP | EPOLLPRI))
         {
-            if (read_callback_)
-                read_callback_();
-
-            // 任意事件
-            if (event_callback_)
-                event_callback_();
+            handler_->handle_read();
+            handled = true;
         }
 
-        if (revents_ & EPOLLOUT) // EPOLLOUT: 可写
+        if (revents & EPOLLOUT) // EPOLLOUT: 可写
         {
-
-            if (write_callback_)
-                write_callback_();
-
-            // 事件处理完毕后调用任意事件回调函数 刷新活跃度
-            if (event_callback_) 
-                event_callback_();
+            handler_->handle_write();
+            handled = true;
         }
-        else if (revents_ & EPOLLERR) // EPOLLERR: 错误
+        else if (revents & EPOLLERR) // EPOLLERR: 错误
         {
-            // 一旦出错则释放连接 不调用任意事件的回调函数
-            if (error_callback_)
-                error_callback_();
+            // 一旦出错则释放连接 不调用任意事件的处理方法
+            handler_->handle_error();
+            return;
         }
-        else if (revents_ & EPOLLHUP) // EPOLLHUP: 对端关闭连接
+        else if (revents & EPOLLHUP) // EPOLLHUP: 对端关闭连接
         {
-            if (close_callback_)
-                close_callback_();
+            handler_->handle_close();
+            return;
         }
+
+        // 读写事件处理完毕后调用一次任意事件处理方法 刷新活跃度
+        if (handled)
+            handler_->handle_any_event();
     }
 
 private:
-    int fd_;           // 监控的文件描述符
-    uint32_t events_;  // 当前监控事件
-    uint32_t revents_; // 当前连接触发事件
+    int fd_;                  // 监控的文件描述符
+    uint32_t events_;         // 当前监控事件
+    uint32_t revents_;        // 当前连接触发事件
+    EventLoop *loop_;         // 所属事件循环
+    ChannelHandler *handler_; // 事件处理对象
+};
+
+// 以std::function作为回调的Channel 自身即为事件处理对象
+// 用于临时监控少量描述符的场景 每个回调都占用内存 大量连接应直接实现ChannelHandler
+class CallbackChannel : public Channel, private ChannelHandler
+{
+public:
+    CallbackChannel(EventLoop *loop, int fd) : Channel(loop, fd) { set_handler(this); }
+
+    void set_read_callback(const event_callback &cb) { read_callback_ = cb; }   // 设置读事件回调函数
+    void set_write_callback(const event_callback &cb) { write_callback_ = cb; } // 设置写事件回调函数
+    void set_error_callback(const event_callback &cb) { error_callback_ = cb; } // 设置错误事件回调函数
+    void set_close_callback(const event_callback &cb) { close_callback_ = cb; } // 设置关闭事件回调函数
+    void set_event_callback(const event_callback &cb) { event_callback_ = cb; } // 设置任意事件回调函数
+
+private:
+    void handle_read() override { invoke(read_callback_); }
+    void handle_write() override { invoke(write_callback_); }
+    void handle_error() override { invoke(error_callback_); }
+    void handle_close() override { invoke(close_callback_); }
+    void handle_any_event() override { invoke(event_callback_); }
 
+    static void invoke(const event_callback &cb)
+    {
+        if (cb)
+            cb();
+    }
+
+private:
     event_callback read_callback_;  // 读事件回调函数
     event_callback write_callback_; // 写事件回调函数
     event_callback error_callback_; // 错误事件回调函数
     event_callback close_callback_; // 关闭事件回调函数
     event_callback event_callback_; // 任意事件回调函数
-};
\ No newline at end of file
+};
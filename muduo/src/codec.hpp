@@ -0,0 +1,91 @@
+#pragma once
+
+#include <string_view>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include "buffer.hpp"
+#include "tcpconnection.hpp"
+#include "log.hpp"
+
+static const size_t CODEC_HEADER_SIZE = sizeof(uint32_t);    // 长度头大小 网络字节序的uint32
+static const size_t CODEC_MAX_FRAME_SIZE = 64 * 1024 * 1024; // 默认最大消息体长度
+static const size_t CODEC_MAX_RESERVE = 64 * 1024;           // 等待消息体时最多预先扩容的大小 更长的消息随数据到达增长
+
+using frame_callback = std::function<void(const TcpConnectionPtr &, std::string_view)>; // 收到完整消息回调 参数为消息体
+
+// 长度头编解码器 每条消息为4字节网络字节序的消息体长度加消息体
+// 解码时消息体以视图交给回调 直接指向输入缓冲区 不拷贝 视图只在回调期间有效 回调中不能修改输入缓冲区
+// 编码时长度头写入缓冲区的前沿预留空间 消息体可直接编码到缓冲区中 无需为长度头搬移或拷贝
+// 长度超过上限的消息视为协议错误 关闭连接 防止对端以伪造的长度耗尽内存
+// 长度头未经验证 只按其预先扩容一小段 缓冲区随实际到达的数据增长 对端只发长度头时不会占用大量内存
+class LengthHeaderCodec
+{
+public:
+    LengthHeaderCodec(const frame_callback &cb, size_t max_frame_size = CODEC_MAX_FRAME_SIZE)
+        : frame_callback_(cb), max_frame_size_(max_frame_size) {}
+
+    // 消息回调 注册为连接的消息回调 取出缓冲区中所有完整的消息 不完整的消息留待后续数据到达
+    void on_message(const TcpConnectionPtr &conn, Buffer *buffer)
+    {
+        while (buffer->readable_size() >= CODEC_HEADER_SIZE)
+        {
+            size_t len = buffer->peek_uint32();
+            if (len > max_frame_size_)
+            {
+                LOG_FMT(ERROR, "connection {} invalid frame length {}", conn->id(), len);
+                buffer->move_read_off(buffer->readable_size());
+                conn->force_close();
+                return;
+            }
+            if (buffer->readable_size() < CODEC_HEADER_SIZE + len)
+            {
+                size_t missing = CODEC_HEADER_SIZE + len - buffer->readable_size();
+                buffer->ensure_writeable(std::min(missing, CODEC_MAX_RESERVE)); // 较短的消息一次扩容到整条消息的大小
+                return;
+            }
+
+            frame_callback_(conn, std::string_view(buffer->begin_read() + CODEC_HEADER_SIZE, len));
+            buffer->move_read_off(CODEC_HEADER_SIZE + len);
+        }
+    }
+
+    // 发送缓冲区中的消息体 在其前补写长度头后整体发送 发送后缓冲区为空
+    // 消息体超过上限或长度头无法表示时不发送 缓冲区保持不变 返回false
+    bool send(const TcpConnectionPtr &conn, Buffer *payload)
+    {
+        if (!check_frame_size(payload->readable_size()))
+            return false;
+        payload->prepend_uint32(static_cast<uint32_t>(payload->readable_size()));
+        conn->send(payload);
+        return true;
+    }
+
+    // 发送消息体 拷贝到带预留空间的缓冲区中 长度头与消息体一次发送
+    bool send(const TcpConnectionPtr &conn, std::string_view payload)
+    {
+        if (!check_frame_size(payload.size()))
+            return false;
+        Buffer buffer(BUFFER_PREPEND_SIZE + payload.size());
+        buffer.write(payload.data(), payload.size());
+        return send(conn, &buffer);
+    }
+
+    size_t max_frame_size() const { return max_frame_size_; }
+
+private:
+    // 检查待发送的消息体长度 对端会以同样的上限拒绝过长的消息
+    bool check_frame_size(size_t len) const
+    {
+        if (len > max_frame_size_ || len > UINT32_MAX)
+        {
+            LOG_FMT(ERROR, "frame length {} exceeds limit {}", len, max_frame_size_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    frame_callback frame_callback_; // 收到完整消息回调
+    size_t max_frame_size_;         // 最大消息体长度
+};
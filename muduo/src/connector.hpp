@@ -0,0 +1,312 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <atomic>
+#include <random>
+#include <algorithm>
+#include <functional>
+#include "sock.hpp"
+#include "channel.hpp"
+#include "eventloop.hpp"
+#include "log.hpp"
+
+static const uint64_t CONNECTOR_INIT_RETRY_MS = 100;  // 首次重试的退避时间(毫秒)
+static const uint64_t CONNECTOR_MAX_RETRY_MS = 30000; // 最大退避时间(毫秒)
+
+using new_connection_callback = std::function<void(int)>; // 连接成功回调 参数为已连接的非阻塞描述符 由回调接管
+using connect_error_callback = std::function<void(int)>;  // 放弃连接回调 参数为最后一次失败的错误码
+
+// 连接器状态
+enum class ConnectorState
+{
+    DISCONNECTED, // 未连接 或等待重试
+    CONNECTING,   // 正在连接 等待套接字可写
+    CONNECTED,    // 已连接 描述符已交给回调
+};
+
+// 非阻塞连接器 在事件循环中发起连接 可写后通过SO_ERROR判断结果
+// 失败时按指数退避重试 实际等待时间在退避时间的一半到全部之间随机 避免大量客户端同时重连
+// 每次成功只产生一个连接 之后需再次start才会发起新的连接
+// 由shared_ptr管理 定时器只持有弱引用 必须在所属事件循环线程中析构
+class Connector : public std::enable_shared_from_this<Connector>, private ChannelHandler
+{
+public:
+    Connector(EventLoop *loop, const std::string &ip, int port)
+        : loop_(loop), ip_(ip), port_(port), state_(ConnectorState::DISCONNECTED), connect_(false),
+          init_retry_ms_(CONNECTOR_INIT_RETRY_MS), max_retry_ms_(CONNECTOR_MAX_RETRY_MS), retry_ms_(CONNECTOR_INIT_RETRY_MS),
+          max_retries_(0), retries_(0), connect_timeout_ms_(0), retry_timer_(0), timeout_timer_(0), rng_(std::random_device()()) {}
+
+    ~Connector()
+    {
+        if (channel_)
+            remove_channel();
+    }
+
+    Connector(const Connector &) = delete;
+    Connector &operator=(const Connector &) = delete;
+
+    // 以下设置必须在start之前调用
+    void set_new_connection_callback(const new_connection_callback &cb) { new_connection_callback_ = cb; }
+    void set_error_callback(const connect_error_callback &cb) { error_callback_ = cb; }
+
+    // 设置退避时间范围 每次失败后退避时间翻倍 直到max_ms
+    void set_retry_delay(uint64_t init_ms, uint64_t max_ms)
+    {
+        init_retry_ms_ = init_ms > 0 ? init_ms : 1;
+        max_retry_ms_ = std::max(max_ms, init_retry_ms_);
+        retry_ms_ = init_retry_ms_;
+    }
+
+    // 设置最大重试次数 超过后放弃并回调error 0表示一直重试
+    void set_max_retries(int count) { max_retries_ = count; }
+
+    // 设置单次连接超时(毫秒) 超时按失败处理并重试 0表示由内核决定
+    void set_connect_timeout(uint64_t timeout_ms) { connect_timeout_ms_ = timeout_ms; }
+
+    EventLoop *owner_loop() const { return loop_; }
+    const std::string &ip() const { return ip_; }
+    int port() const { return port_; }
+    ConnectorState state() const { return state_; } // 只能在所属线程中读取
+    int retries() const { return retries_; }        // 本次start以来的失败次数
+
+    // 开始连接 可在任意线程调用
+    void start()
+    {
+        connect_ = true;
+        std::shared_ptr<Connector> self(shared_from_this());
+        loop_->run_in_loop([self]()
+                           { self->start_in_loop(); });
+    }
+
+    // 停止连接 取消正在进行的连接和等待中的重试 可在任意线程调用
+    void stop()
+    {
+        connect_ = false;
+        std::shared_ptr<Connector> self(shared_from_this());
+        loop_->queue_in_loop([self]()
+                             { self->stop_in_loop(); });
+    }
+
+    // 重新开始连接 重置退避时间和重试次数 只能在所属线程中调用 用于连接断开后重连
+    void restart()
+    {
+        loop_->assert_in_loop();
+        state_ = ConnectorState::DISCONNECTED;
+        retry_ms_ = init_retry_ms_;
+        retries_ = 0;
+        connect_ = true;
+        start_in_loop();
+    }
+
+private:
+    void start_in_loop()
+    {
+        loop_->assert_in_loop();
+        retry_timer_ = 0;
+        if (!connect_ || state_ != ConnectorState::DISCONNECTED)
+            return;
+        connect();
+    }
+
+    void stop_in_loop()
+    {
+        loop_->assert_in_loop();
+        if (retry_timer_ != 0)
+        {
+            loop_->cancel(retry_timer_);
+            retry_timer_ = 0;
+        }
+        if (state_ == ConnectorState::CONNECTING)
+        {
+            remove_channel();
+            socket_.Close();
+            state_ = ConnectorState::DISCONNECTED;
+        }
+    }
+
+    // 创建非阻塞套接字并发起连接 按错误码区分正在连接 可重试和不可恢复的错误
+    void connect()
+    {
+        if (!socket_.Create())
+        {
+            retry(errno);
+            return;
+        }
+        socket_.NonBlock();
+
+        int saved_errno = 0;
+        if (socket_.ConnectNonBlock(ip_, port_, &saved_errno) == 0)
+        {
+            connecting();
+            return;
+        }
+
+        switch (saved_errno)
+        {
+        case EINTR:
+        case EISCONN:
+            connecting(); // 连接仍在进行或已完成 由可写事件确认
+            break;
+        case EAGAIN:
+        case EADDRINUSE:
+        case EADDRNOTAVAIL:
+        case ECONNREFUSED:
+        case ENETUNREACH:
+        case EHOSTUNREACH:
+        case ETIMEDOUT:
+            socket_.Close();
+            retry(saved_errno);
+            break;
+        default:
+            // 地址或权限错误 重试没有意义
+            LOG_FMT(ERROR, "connect to {}:{} failed! errno={}", ip_, port_, saved_errno);
+            socket_.Close();
+            give_up(saved_errno);
+            break;
+        }
+    }
+
+    // 等待套接字可写 连接完成或失败时都会触发
+    void connecting()
+    {
+        state_ = ConnectorState::CONNECTING;
+        channel_.reset(new Channel(loop_, socket_.GetFd()));
+        channel_->set_handler(this);
+        channel_->enable_write();
+
+        if (connect_timeout_ms_ > 0)
+        {
+            std::weak_ptr<Connector> weak(shared_from_this());
+            timeout_timer_ = loop_->run_after(connect_timeout_ms_ * 1000, [weak]()
+                                              {
+                std::shared_ptr<Connector> self = weak.lock();
+                if (self)
+                    self->handle_timeout(); });
+        }
+    }
+
+    // 停止监控并释放Channel 正在处理该Channel的事件 延迟到任务队列中释放
+    void remove_channel()
+    {
+        if (timeout_timer_ != 0)
+        {
+            loop_->cancel(timeout_timer_);
+            timeout_timer_ = 0;
+        }
+        channel_->disable_all();
+        channel_->remove();
+        std::shared_ptr<Channel> channel(channel_.release());
+        loop_->queue_in_loop([channel]() {});
+    }
+
+    // 套接字可写 检查连接结果
+    void handle_write() override
+    {
+        if (state_ != ConnectorState::CONNECTING)
+            return;
+
+        remove_channel();
+        int err = socket_.GetError();
+        if (err != 0)
+        {
+            socket_.Close();
+            retry(err);
+            return;
+        }
+        if (socket_.IsSelfConnect())
+        {
+            LOG_FMT(WARN, "connect to {}:{} self connected, retrying", ip_, port_);
+            socket_.Close();
+            retry(ECONNREFUSED);
+            return;
+        }
+
+        state_ = ConnectorState::CONNECTED;
+        int fd = socket_.Release();
+        if (connect_ && new_connection_callback_)
+            new_connection_callback_(fd);
+        else
+            close(fd); // 已停止或没有接管者
+    }
+
+    // 套接字出错 连接失败
+    void handle_error() override
+    {
+        if (state_ != ConnectorState::CONNECTING)
+            return;
+
+        remove_channel();
+        int err = socket_.GetError();
+        socket_.Close();
+        retry(err != 0 ? err : ECONNREFUSED);
+    }
+
+    // 连接超时
+    void handle_timeout()
+    {
+        timeout_timer_ = 0;
+        if (state_ != ConnectorState::CONNECTING)
+            return;
+
+        remove_channel();
+        socket_.Close();
+        retry(ETIMEDOUT);
+    }
+
+    // 按退避时间安排下一次连接 超过最大重试次数时放弃
+    void retry(int err)
+    {
+        state_ = ConnectorState::DISCONNECTED;
+        if (!connect_)
+            return;
+
+        retries_++;
+        if (max_retries_ > 0 && retries_ > max_retries_)
+        {
+            LOG_FMT(WARN, "connect to {}:{} failed after {} retries! errno={}", ip_, port_, max_retries_, err);
+            give_up(err);
+            return;
+        }
+
+        // 在退避时间的一半到全部之间随机选择等待时间
+        uint64_t delay_ms = retry_ms_ / 2 + rng_() % (retry_ms_ - retry_ms_ / 2 + 1);
+        retry_ms_ = std::min(retry_ms_ * 2, max_retry_ms_);
+        LOG_FMT(DEBUG, "connect to {}:{} failed! errno={} retry in {}ms", ip_, port_, err, delay_ms);
+
+        std::weak_ptr<Connector> weak(shared_from_this());
+        retry_timer_ = loop_->run_after(delay_ms * 1000, [weak]()
+                                        {
+            std::shared_ptr<Connector> self = weak.lock();
+            if (self)
+                self->start_in_loop(); });
+    }
+
+    void give_up(int err)
+    {
+        state_ = ConnectorState::DISCONNECTED;
+        connect_ = false;
+        if (error_callback_)
+            error_callback_(err);
+    }
+
+private:
+    EventLoop *loop_;                                 // 所属事件循环
+    std::string ip_;                                  // 服务器地址
+    int port_;                                        // 服务器端口
+    ConnectorState state_;                            // 连接状态
+    std::atomic<bool> connect_;                       // 是否需要连接 stop后为false
+    uint64_t init_retry_ms_;                          // 首次重试的退避时间(毫秒)
+    uint64_t max_retry_ms_;                           // 最大退避时间(毫秒)
+    uint64_t retry_ms_;                               // 当前退避时间(毫秒)
+    int max_retries_;                                 // 最大重试次数 0表示一直重试
+    int retries_;                                     // 已失败次数
+    uint64_t connect_timeout_ms_;                     // 单次连接超时(毫秒)
+    TimerId retry_timer_;                             // 等待重试的定时器
+    TimerId timeout_timer_;                           // 连接超时定时器
+    Socket socket_;                                   // 正在连接的套接字
+    std::unique_ptr<Channel> channel_;                // 正在连接的套接字对应的Channel
+    std::minstd_rand rng_;                            // 退避时间的随机数
+    new_connection_callback new_connection_callback_; // 连接成功回调
+    connect_error_callback error_callback_;           // 放弃连接回调
+};
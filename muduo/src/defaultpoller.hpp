@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdlib>
+#include "poller.hpp"
+#include "epollpoller.hpp"
+#include "uringpoller.hpp"
+#include "log.hpp"
+
+// 创建事件循环使用的Poller 默认使用epoll
+// 设置环境变量MUDUO_USE_URING时使用io_uring 内核不支持时回退到epoll
+inline Poller *new_default_poller()
+{
+    if (getenv("MUDUO_USE_URING"))
+    {
+        UringPoller *poller = new UringPoller;
+        if (poller->valid())
+            return poller;
+
+        LOG_MSG(WARN, "io_uring unavailable, fallback to epoll");
+        delete poller;
+    }
+    return new EpollPoller;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include "poller.hpp"
+#include "log.hpp"
+
+static const int POLLER_INIT_EVENTS = 16;    // 就绪事件数组初始大小
+static const int POLLER_MAX_EVENTS = 65536; // 就绪事件数组最大大小
+
+// 基于epoll的Poller Channel的监控事件直接作为epoll事件使用
+class EpollPoller : public Poller
+{
+public:
+    // 构造函数 创建epoll实例
+    EpollPoller() : epfd_(epoll_create1(EPOLL_CLOEXEC)), events_(POLLER_INIT_EVENTS)
+    {
+        if (epfd_ == -1)
+        {
+            LOG_MSG(FATAL, "create epoll failed!");
+            abort();
+        }
+    }
+
+    // 析构函数 关闭epoll实例
+    ~EpollPoller() override { close(epfd_); }
+
+    const char *name() const override { return "epoll"; }
+
+    // 添加或修改描述符的监控事件
+    void update_event(Channel *channel) override
+    {
+        auto it = channels_.find(channel->fd());
+        if (it == channels_.end())
+        {
+            // 未监控则添加
+            channels_[channel->fd()] = channel;
+            update(EPOLL_CTL_ADD, channel);
+            return;
+        }
+
+        assert(it->second == channel);
+        if (channel->events() & EPOLLEXCLUSIVE)
+        {
+            // 独占唤醒的描述符不能使用EPOLL_CTL_MOD 删除后重新添加
+            update(EPOLL_CTL_DEL, channel);
+            update(EPOLL_CTL_ADD, channel);
+            return;
+        }
+        update(EPOLL_CTL_MOD, channel);
+    }
+
+    // 移除描述符的监控
+    void remove_event(Channel *channel) override
+    {
+        auto it = channels_.find(channel->fd());
+        if (it == channels_.end())
+            return;
+
+        channels_.erase(it);
+        update(EPOLL_CTL_DEL, channel);
+    }
+
+    // 开始监控 就绪的Channel追加到active中 timeout: 超时时间(毫秒) -1表示阻塞
+    void poll(std::vector<Channel *> *active, int timeout) override
+    {
+        int nfds = epoll_wait(epfd_, events_.data(), static_cast<int>(events_.size()), timeout);
+        if (nfds == -1)
+        {
+            if (errno != EINTR)
+                LOG_MSG(ERROR, "epoll wait failed!");
+            return;
+        }
+
+        for (int i = 0; i < nfds; i++)
+        {
+            Channel *channel = static_cast<Channel *>(events_[i].data.ptr);
+            channel->set_revents(events_[i].events); // 设置实际就绪事件
+            active->push_back(channel);
+        }
+
+        // 就绪数组被填满说明负载较高 扩容以减少下次epoll_wait的次数
+        if (static_cast<size_t>(nfds) == events_.size() && events_.size() < POLLER_MAX_EVENTS)
+            events_.resize(events_.size() * 2);
+    }
+
+private:
+    // 对epoll执行实际操作
+    void update(int op, Channel *channel)
+    {
+        struct epoll_event ev;
+        ev.events = channel->events();
+        ev.data.ptr = channel;
+        if (epoll_ctl(epfd_, op, channel->fd(), &ev) == -1)
+            LOG_FMT(ERROR, "epoll ctl failed! fd={}", channel->fd());
+    }
+
+private:
+    int epfd_;                               // epoll描述符
+    std::vector<struct epoll_event> events_; // 就绪事件数组
+};
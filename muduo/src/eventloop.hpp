@@ -0,0 +1,279 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <cassert>
+#include <csignal>
+#include <sys/eventfd.h>
+#include "channel.hpp"
+#include "defaultpoller.hpp"
+#include "bufferpool.hpp"
+#include "timerqueue.hpp"
+#include "loopmetrics.hpp"
+#include "mpscqueue.hpp"
+#include "log.hpp"
+
+static const int EVENTLOOP_POLL_TIMEOUT = 10000; // epoll_wait超时时间(毫秒)
+
+using task_func = std::function<void()>; // 投递到事件循环中执行的任务
+
+// 进程启动时忽略SIGPIPE 向已重置的连接写入时只返回EPIPE 不终止进程
+// send和sendmsg可以带MSG_NOSIGNAL sendfile和splice没有标志位 只能在进程级别忽略
+class IgnoreSigPipe
+{
+public:
+    IgnoreSigPipe() { ::signal(SIGPIPE, SIG_IGN); }
+};
+
+inline IgnoreSigPipe ignore_sigpipe; // 所有编译单元共享 只初始化一次
+
+class EventLoop : private ChannelHandler
+{
+public:
+    // 构造函数 事件循环与创建它的线程绑定
+    EventLoop()
+        : thread_id_(std::this_thread::get_id()), quit_(false), load_(0), poller_(new_default_poller()),
+          wakeup_fd_(create_eventfd()), wakeup_channel_(this, wakeup_fd_), notified_(false),
+          timer_queue_(this, &metrics_)
+    {
+        // 监控eventfd的读事件 用于其他线程唤醒阻塞在epoll_wait中的事件循环
+        wakeup_channel_.set_handler(this);
+        wakeup_channel_.enable_read();
+    }
+
+    ~EventLoop()
+    {
+        wakeup_channel_.remove();
+        close(wakeup_fd_);
+    }
+
+    EventLoop(const EventLoop &) = delete;
+    EventLoop &operator=(const EventLoop &) = delete;
+
+    // 开始事件循环 只能在所属线程中调用
+    void loop()
+    {
+        assert_in_loop();
+        uint64_t start = metrics_now_ns();
+        while (!quit_)
+        {
+            active_channels_.clear();
+            poller_->poll(&active_channels_, EVENTLOOP_POLL_TIMEOUT); // 等待事件就绪
+            notified_.exchange(true, std::memory_order_acq_rel);      // 处理事件期间投递的任务无需唤醒
+            uint64_t polled = metrics_now_ns();
+            for (Channel *channel : active_channels_)
+                channel->handle_event(); // 分发就绪事件
+            run_pending_tasks();         // 执行其他线程投递的任务
+
+            // 本轮结束时间即下一轮的开始时间 每轮只读两次时钟
+            uint64_t end = metrics_now_ns();
+            metrics_.record_iteration(polled - start, end - polled, active_channels_.size());
+            start = end;
+        }
+        quit_ = false; // 退出后复位 早于loop()调用的quit不会丢失 且事件循环可再次启动
+    }
+
+    // 退出事件循环 在当前轮事件处理完毕后生效 可在任意线程调用
+    void quit()
+    {
+        quit_ = true;
+        if (!is_in_loop_thread())
+            wakeup();
+    }
+
+    // 在事件循环所属线程中执行任务 当前线程即为所属线程时直接执行
+    void run_in_loop(task_func task)
+    {
+        if (is_in_loop_thread())
+            task();
+        else
+            queue_in_loop(std::move(task));
+    }
+
+    // 将任务压入任务队列 在本轮事件处理完毕后执行 可在任意线程调用
+    // 只有事件循环可能阻塞在poll中且尚未被通知时才写eventfd 一次唤醒覆盖之后投递的一批任务
+    void queue_in_loop(task_func task)
+    {
+        pending_tasks_.push(std::move(task));
+
+        // 必须在压入之后检查 与run_pending_tasks中先清除标记再取任务的顺序配合 保证任务不会滞留
+        if (!notified_.exchange(true, std::memory_order_acq_rel))
+            wakeup();
+    }
+
+    // 唤醒阻塞在epoll_wait中的事件循环
+    void wakeup()
+    {
+        metrics_.wakeup_writes.fetch_add(1, std::memory_order_relaxed);
+        uint64_t one = 1;
+        if (write(wakeup_fd_, &one, sizeof(one)) != sizeof(one))
+            LOG_MSG(ERROR, "wakeup eventloop failed!");
+    }
+
+    // 在when_us时刻执行回调 时间为timer_now()所用的单调时钟(微秒) 可在任意线程调用
+    TimerId run_at(uint64_t when_us, timer_callback cb) { return timer_queue_.add_timer(std::move(cb), when_us, 0); }
+
+    // delay_us微秒后执行回调 可在任意线程调用
+    TimerId run_after(uint64_t delay_us, timer_callback cb) { return run_at(timer_now() + delay_us, std::move(cb)); }
+
+    // 每隔interval_us微秒执行一次回调 可在任意线程调用
+    TimerId run_every(uint64_t interval_us, timer_callback cb)
+    {
+        return timer_queue_.add_timer(std::move(cb), timer_now() + interval_us, interval_us);
+    }
+
+    // 取消定时器 可在任意线程调用
+    void cancel(TimerId id) { timer_queue_.cancel(id); }
+
+    // 事件循环负载 即当前监控的描述符数量 可在任意线程读取
+    size_t load() const { return load_.load(std::memory_order_relaxed); }
+
+    // 添加或修改描述符的监控事件
+    void update_event(Channel *channel)
+    {
+        assert(channel->owner_loop() == this);
+        assert_in_loop();
+        poller_->update_event(channel);
+        load_.store(poller_->channel_count(), std::memory_order_relaxed);
+    }
+
+    // 移除描述符的监控
+    void remove_event(Channel *channel)
+    {
+        assert(channel->owner_loop() == this);
+        assert_in_loop();
+        poller_->remove_event(channel);
+        load_.store(poller_->channel_count(), std::memory_order_relaxed);
+    }
+
+    // 获取本事件循环的缓冲区内存池 只能在所属线程中分配和释放
+    BufferPool *buffer_pool() { return &buffer_pool_; }
+
+    // 获取运行统计 计数器只能在所属线程中修改 可在任意线程读取
+    LoopMetrics &metrics() { return metrics_; }
+    const LoopMetrics &metrics() const { return metrics_; }
+
+    // 运行统计的纯文本格式 每项一行 以name为前缀 可在任意线程调用
+    std::string metrics_text(const std::string &name) const
+    {
+        std::string text = name + ".poller " + poller_->name() + "\n";
+        format_loop_metrics(&text, name, metrics_, buffer_pool_.stats());
+        return text;
+    }
+
+    // 使用的Poller实现名称
+    const char *poller_name() const { return poller_->name(); }
+
+    // 判断描述符是否在监控中
+    bool has_channel(Channel *channel) const { return poller_->has_channel(channel); }
+
+    // 判断当前线程是否为事件循环所属线程
+    bool is_in_loop_thread() const { return thread_id_ == std::this_thread::get_id(); }
+
+    // 断言当前线程为事件循环所属线程
+    void assert_in_loop() const { assert(is_in_loop_thread()); }
+
+private:
+    // 创建用于唤醒的eventfd
+    static int create_eventfd()
+    {
+        int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (fd == -1)
+        {
+            LOG_MSG(FATAL, "create eventfd failed!");
+            abort();
+        }
+        return fd;
+    }
+
+    // 读取eventfd 清除唤醒事件
+    void handle_read() override
+    {
+        uint64_t count = 0;
+        if (read(wakeup_fd_, &count, sizeof(count)) != sizeof(count) && errno != EAGAIN)
+            LOG_MSG(ERROR, "read eventfd failed!");
+    }
+
+    // 执行任务队列中的所有任务
+    // 先清除通知标记再取出任务 此后投递的任务会重新唤醒事件循环 不会滞留到下一次事件就绪
+    // notified_的所有修改都是读改写操作 清除标记时与之前投递方的标记操作同步 能看到它们压入的任务
+    // 先全部取出再执行 执行期间新投递的任务留到下一轮 避免任务不断投递自身时饿死IO事件
+    void run_pending_tasks()
+    {
+        notified_.exchange(false, std::memory_order_acq_rel);
+        task_func task;
+        while (pending_tasks_.pop(&task))
+            running_tasks_.push_back(std::move(task));
+        if (running_tasks_.empty())
+            return;
+
+        metric_add(metrics_.tasks, running_tasks_.size());
+        metrics_.task_batch.record(running_tasks_.size());
+        for (const task_func &task : running_tasks_)
+            task();
+        running_tasks_.clear();
+    }
+
+private:
+    std::thread::id thread_id_;              // 所属线程id
+    std::atomic<bool> quit_;                 // 是否退出事件循环
+    std::atomic<size_t> load_;               // 当前监控的描述符数量
+    std::unique_ptr<Poller> poller_;         // 描述符事件监控
+    std::vector<Channel *> active_channels_; // 就绪的Channel
+    BufferPool buffer_pool_;                 // 缓冲区内存池
+    LoopMetrics metrics_;                    // 运行统计
+
+    int wakeup_fd_;                        // 用于唤醒事件循环的eventfd
+    Channel wakeup_channel_;               // eventfd对应的Channel
+    MpscQueue<task_func> pending_tasks_;   // 投递的任务队列 无锁多生产者单消费者
+    std::vector<task_func> running_tasks_; // 本轮取出待执行的任务 复用存储空间
+    std::atomic<bool> notified_;           // 事件循环已被唤醒或正在处理事件 此时投递任务无需写eventfd
+    TimerQueue timer_queue_;               // 定时器队列
+};
+
+// Channel中依赖EventLoop完整定义的成员函数
+inline void Channel::update() { loop_->update_event(this); }
+inline void Channel::remove() { loop_->remove_event(this); }
+
+// TimerQueue中依赖EventLoop完整定义的成员函数
+inline TimerId TimerQueue::add_timer(timer_callback cb, uint64_t when_us, uint64_t interval_us)
+{
+    TimerId id = next_id_.fetch_add(1, std::memory_order_relaxed);
+    Timer timer{std::move(cb), when_us, interval_us};
+    if (loop_->is_in_loop_thread())
+        add_timer_in_loop(id, std::move(timer));
+    else
+        loop_->queue_in_loop([this, id, timer]() mutable
+                             { add_timer_in_loop(id, std::move(timer)); });
+    return id;
+}
+
+inline void TimerQueue::cancel_in_loop(TimerId id, bool requeued)
+{
+    auto it = timers_.find(id);
+    if (it != timers_.end())
+    {
+        entries_.erase(Entry(it->second.when, id));
+        timers_.erase(it);
+        return;
+    }
+
+    // 正在执行到期定时器时取消自身 阻止重复定时器被再次加入
+    if (calling_expired_)
+        canceling_.insert(id);
+
+    // 其他线程添加的定时器可能仍在任务队列中 而本线程的取消已立即执行
+    // 取消任务排在添加任务之后 再取消一次 已执行或不存在的定时器只多一次查找
+    if (!requeued)
+        loop_->queue_in_loop([this, id]()
+                             { cancel_in_loop(id, true); });
+}
+
+inline void TimerQueue::cancel(TimerId id)
+{
+    loop_->run_in_loop([this, id]()
+                       { cancel_in_loop(id); });
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+#include <strings.h>
+#include <string_view>
+#include "buffer.hpp"
+#include "scanner.hpp"
+
+static const size_t HTTP_MAX_HEADERS = 64;       // 最多解析的头部字段数量
+static const size_t HTTP_MAX_HEADER_SIZE = 8192; // 请求行与头部的最大总长度
+
+// 解析结果
+enum class HttpParseResult
+{
+    COMPLETE,    // 请求行与头部已完整解析
+    INCOMPLETE,  // 数据不完整 需等待更多数据后再次调用parse
+    BAD_REQUEST, // 请求格式错误或超出长度限制
+};
+
+// 头部字段 视图指向Buffer中的原始数据
+struct HttpHeader
+{
+    std::string_view name;  // 字段名
+    std::string_view value; // 字段值 已去掉两端空白
+};
+
+// 增量式HTTP/1.x请求解析器 只解析请求行与头部 不申请内存也不拷贝数据
+// 解析结果以相对于读位置的偏移保存 数据分多次到达或缓冲区扩容后均可从上次位置继续解析
+// 返回的视图在缓冲区被修改前有效 处理完请求后调用buffer.move_read_off(message_size())并reset()
+class HttpRequestParser
+{
+public:
+    HttpRequestParser() { reset(); }
+
+    // 重置解析状态 用于解析下一个请求
+    void reset()
+    {
+        state_ = REQUEST_LINE;
+        base_ = nullptr;
+        parsed_ = 0;
+        scan_from_ = 0;
+        header_count_ = 0;
+        method_ = path_ = version_ = Span{0, 0};
+    }
+
+    // 解析缓冲区中的可读数据 不移动读索引
+    HttpParseResult parse(Buffer &buffer)
+    {
+        const char *begin = buffer.begin_read();
+        const char *end = begin + buffer.readable_size();
+        base_ = begin;
+
+        while (state_ != COMPLETE)
+        {
+            const char *crlf = scan_crlf(begin + scan_from_, end);
+            if (crlf == end)
+            {
+                if (buffer.readable_size() > HTTP_MAX_HEADER_SIZE)
+                    return HttpParseResult::BAD_REQUEST;
+
+                // 最后一个字节可能是'\r' 下次从这里继续查找 已扫描过的数据不再重复扫描
+                size_t readable = end - begin;
+                scan_from_ = readable > parsed_ ? readable - 1 : parsed_;
+                return HttpParseResult::INCOMPLETE;
+            }
+
+            if (static_cast<size_t>(crlf - begin) + 2 > HTTP_MAX_HEADER_SIZE)
+                return HttpParseResult::BAD_REQUEST;
+
+            const char *line = begin + parsed_;
+            bool ok = true;
+            if (state_ == REQUEST_LINE)
+            {
+                ok = parse_request_line(line, crlf);
+                state_ = HEADERS;
+            }
+            else if (line == crlf)
+            {
+                state_ = COMPLETE; // 空行表示头部结束
+            }
+            else
+            {
+                ok = parse_header(line, crlf);
+            }
+
+            if (!ok)
+                return HttpParseResult::BAD_REQUEST;
+
+            parsed_ = scan_from_ = crlf - begin + 2; // 跳过CRLF
+        }
+        return HttpParseResult::COMPLETE;
+    }
+
+    std::string_view method() const { return view(method_); }   // 请求方法
+    std::string_view path() const { return view(path_); }       // 请求路径
+    std::string_view version() const { return view(version_); } // 协议版本
+
+    size_t header_count() const { return header_count_; } // 头部字段数量
+
+    // 获取第index个头部字段
+    HttpHeader header(size_t index) const
+    {
+        assert(index < header_count_);
+        return HttpHeader{view(headers_[index].name), view(headers_[index].value)};
+    }
+
+    // 按字段名查找头部字段值 字段名不区分大小写 不存在时返回空视图
+    std::string_view get_header(std::string_view name) const
+    {
+        for (size_t i = 0; i < header_count_; i++)
+        {
+            std::string_view field = view(headers_[i].name);
+            if (field.size() == name.size() && strncasecmp(field.data(), name.data(), name.size()) == 0)
+                return view(headers_[i].value);
+        }
+        return std::string_view();
+    }
+
+    // 请求行与头部的总长度 包括结尾的空行
+    size_t message_size() const { return parsed_; }
+
+    // 是否已完整解析
+    bool complete() const { return state_ == COMPLETE; }
+
+private:
+    // 数据在缓冲区中相对于读位置的偏移
+    struct Span
+    {
+        uint32_t off; // 偏移
+        uint32_t len; // 长度
+    };
+
+    struct HeaderSpan
+    {
+        Span name;  // 字段名
+        Span value; // 字段值
+    };
+
+    enum State
+    {
+        REQUEST_LINE, // 等待请求行
+        HEADERS,      // 解析头部
+        COMPLETE,     // 解析完成
+    };
+
+    Span span(const char *begin, const char *end) const
+    {
+        return Span{static_cast<uint32_t>(begin - base_), static_cast<uint32_t>(end - begin)};
+    }
+
+    std::string_view view(const Span &s) const { return std::string_view(base_ + s.off, s.len); }
+
+    // 解析请求行 METHOD SP PATH SP VERSION
+    bool parse_request_line(const char *line, const char *end)
+    {
+        const char *sp1 = scan_char(line, end, ' ');
+        if (sp1 == line || sp1 == end)
+            return false;
+
+        const char *path = sp1 + 1;
+        const char *sp2 = scan_char(path, end, ' ');
+        if (sp2 == path || sp2 == end)
+            return false;
+
+        const char *version = sp2 + 1;
+        if (end - version != 8 || memcmp(version, "HTTP/1.", 7) != 0 || (version[7] != '0' && version[7] != '1'))
+            return false;
+
+        method_ = span(line, sp1);
+        path_ = span(path, sp2);
+        version_ = span(version, end);
+        return true;
+    }
+
+    // 解析头部字段 NAME ":" OWS VALUE OWS
+    bool parse_header(const char *line, const char *end)
+    {
+        // 不支持已废弃的折行 字段名前后不允许出现空白
+        if (*line == ' ' || *line == '\t' || header_count_ == HTTP_MAX_HEADERS)
+            return false;
+
+        const char *colon = scan_char(line, end, ':');
+        if (colon == line || colon == end || colon[-1] == ' ' || colon[-1] == '\t')
+            return false;
+
+        const char *value = colon + 1;
+        const char *value_end = end;
+        while (value < value_end && (*value == ' ' || *value == '\t'))
+            value++;
+        while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t'))
+            value_end--;
+
+        headers_[header_count_++] = HeaderSpan{span(line, colon), span(value, value_end)};
+        return true;
+    }
+
+private:
+    State state_;                          // 解析状态
+    const char *base_;                     // 最近一次解析时的读位置
+    size_t parsed_;                        // 已解析数据的长度
+    size_t scan_from_;                     // 下次查找CRLF的起始偏移
+    Span method_;                          // 请求方法
+    Span path_;                            // 请求路径
+    Span version_;                         // 协议版本
+    size_t header_count_;                  // 头部字段数量
+    HeaderSpan headers_[HTTP_MAX_HEADERS]; // 头部字段
+};
@@ -6,6 +6,18 @@
 #include <chrono>
 #include <iomanip>
 #include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <string_view>
+#include <charconv>
+#include <type_traits>
 
 #define DEBUG 1
 #define INFO 2
@@ -24,34 +36,252 @@
 #define CYAN "\033[36m"    /* Cyan */
 #define WHITE "\033[37m"   /* White */
 
+static const size_t LOG_LINE_SIZE = 4096;              // 单条日志最大长度 超出部分被截断
+static const size_t LOG_BUFFER_SIZE = 4 * 1024 * 1024; // 异步日志缓冲区大小
+static const size_t LOG_MAX_PENDING_BUFFERS = 16;      // 等待写入的缓冲区上限 超出后丢弃新日志
+static const int LOG_FLUSH_INTERVAL = 3;               // 后台线程刷新间隔(秒)
+
 // 定义一个静态文件流对象
 // static std::ofstream logFile("log.txt", std::ios::app);
 
 static int current_level = INFO; // 设置默认日志级别为INFO
 
 // 设置日志级别
-void set_log_level(int level)
+inline void set_log_level(int level)
 {
     current_level = level;
 }
 
-void log_msg(int level, const std::string &msg, const std::string &file, int line)
+// 定长日志缓冲区 前端追加 后台线程整块写出
+class LogBuffer
 {
-    // 如果消息的级别低于当前级别，则不打印
-    if (level < current_level)
+public:
+    LogBuffer() : data_(new char[LOG_BUFFER_SIZE]), size_(0) {}
+
+    void append(const char *data, size_t len)
+    {
+        memcpy(data_.get() + size_, data, len);
+        size_ += len;
+    }
+
+    size_t avail() const { return LOG_BUFFER_SIZE - size_; } // 剩余空间
+    const char *data() const { return data_.get(); }
+    size_t size() const { return size_; }
+    void reset() { size_ = 0; }
+
+private:
+    std::unique_ptr<char[]> data_; // 缓冲区
+    size_t size_;                  // 已写入大小
+};
+
+// 异步日志后端 双缓冲
+// 前端线程只在锁内把日志拷贝进预先分配的缓冲区 后台线程交换出写满的缓冲区后批量写入文件
+// 待写缓冲区达到上限时丢弃新日志并计数 由后台线程在输出中注明丢弃数量 内存占用有上界
+class AsyncLogging
+{
+public:
+    AsyncLogging(FILE *file, bool owns_file)
+        : file_(file), owns_file_(owns_file), running_(true), dropped_(0), flush_requests_(0), flushed_(0),
+          current_(new LogBuffer), next_(new LogBuffer)
+    {
+        thread_ = std::thread(std::bind(&AsyncLogging::thread_entry, this));
+    }
+
+    // 析构函数 写出剩余日志后退出后台线程
+    ~AsyncLogging()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            running_ = false;
+        }
+        cond_.notify_one();
+        thread_.join();
+
+        if (owns_file_)
+            fclose(file_);
+    }
+
+    AsyncLogging(const AsyncLogging &) = delete;
+    AsyncLogging &operator=(const AsyncLogging &) = delete;
+
+    // 追加一条日志 可在任意线程调用
+    void append(const char *line, size_t len)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (current_->avail() > len)
+        {
+            current_->append(line, len);
+            return;
+        }
+
+        // 当前缓冲区已满 待写缓冲区过多说明后台写入跟不上 丢弃本条日志
+        if (buffers_.size() >= LOG_MAX_PENDING_BUFFERS)
+        {
+            dropped_++;
+            return;
+        }
+
+        buffers_.push_back(std::move(current_));
+        if (next_)
+            current_ = std::move(next_); // 使用备用缓冲区
+        else
+            current_.reset(new LogBuffer); // 备用缓冲区也已用完 极少发生
+        current_->append(line, len);
+        cond_.notify_one();
+    }
+
+    // 阻塞直到此前追加的日志全部写入文件
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        uint64_t target = ++flush_requests_;
+        cond_.notify_one();
+        flushed_cond_.wait(lock, [this, target]()
+                           { return flushed_ >= target || !running_; });
+    }
+
+private:
+    using BufferPtr = std::unique_ptr<LogBuffer>;
+
+    // 后台线程 定期或在缓冲区写满时交换出缓冲区并写入文件
+    void thread_entry()
+    {
+        BufferPtr spare1(new LogBuffer); // 用于替换current_
+        BufferPtr spare2(new LogBuffer); // 用于替换next_
+        std::vector<BufferPtr> to_write;
+        bool running = true;
+
+        while (running)
+        {
+            size_t dropped = 0;
+            uint64_t requests = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                if (buffers_.empty() && running_ && flush_requests_ == flushed_)
+                    cond_.wait_for(lock, std::chrono::seconds(LOG_FLUSH_INTERVAL));
+
+                buffers_.push_back(std::move(current_));
+                current_ = std::move(spare1);
+                to_write.swap(buffers_);
+                if (!next_)
+                    next_ = std::move(spare2);
+                dropped = dropped_;
+                dropped_ = 0;
+                requests = flush_requests_;
+                running = running_;
+            }
+
+            // 以下在锁外执行 不阻塞前端线程
+            if (dropped > 0)
+            {
+                char note[128];
+                int n = snprintf(note, sizeof(note), "[LOG] dropped %zu messages: backend is too slow\n", dropped);
+                fwrite(note, 1, n, file_);
+            }
+
+            for (const BufferPtr &buffer : to_write)
+                fwrite(buffer->data(), 1, buffer->size(), file_);
+            fflush(file_);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                flushed_ = requests;
+            }
+            flushed_cond_.notify_all();
+
+            // 保留两个缓冲区供下一轮交换 其余释放
+            to_write.resize(2);
+            spare1 = std::move(to_write[0]);
+            spare1->reset();
+            if (!spare2)
+            {
+                spare2 = std::move(to_write[1]);
+                if (spare2)
+                    spare2->reset();
+                else
+                    spare2.reset(new LogBuffer);
+            }
+            to_write.clear();
+        }
+    }
+
+private:
+    FILE *file_;                           // 日志文件
+    bool owns_file_;                       // 是否负责关闭文件
+    bool running_;                         // 后台线程是否运行
+    size_t dropped_;                       // 被丢弃的日志数量
+    uint64_t flush_requests_;              // 请求刷新的次数
+    uint64_t flushed_;                     // 已完成刷新的次数
+    BufferPtr current_;                    // 当前写入的缓冲区
+    BufferPtr next_;                       // 备用缓冲区
+    std::vector<BufferPtr> buffers_;       // 已写满等待写入的缓冲区
+    std::mutex mutex_;                     // 保护以上成员
+    std::condition_variable cond_;         // 通知后台线程
+    std::condition_variable flushed_cond_; // 通知刷新完成
+    std::thread thread_;                   // 后台线程
+};
+
+// 异步日志后端 为空时同步输出到终端 所有编译单元共享同一个后端 只能经由std::atomic_load和std::atomic_store访问
+// 写日志的线程取得后端的引用后再写入 替换或关闭时只等待持有旧后端的线程 与其他线程是否正在写日志无关
+inline std::shared_ptr<AsyncLogging> async_logging;
+
+// 摘下后的后端不会再被新的写入者取得 等待已取得它的写入者释放引用后 在本线程中写出剩余日志并释放
+inline void retire_async_logging(std::shared_ptr<AsyncLogging> backend)
+{
+    if (!backend)
         return;
+    while (backend.use_count() > 1)
+        std::this_thread::yield();
+    backend.reset();
+}
 
-    // 获取当前时间
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    std::tm *localTime = std::localtime(&time);
+// 开启异步日志 日志写入path 文件打开失败返回false 已开启时替换原有的后端
+inline bool start_async_logging(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "ae");
+    if (file == nullptr)
+        return false;
 
-    // 使用strftime格式化时间
-    char timeStr[100];
-    strftime(timeStr, sizeof(timeStr), "[%Y-%m-%d %H:%M:%S] ", localTime);
+    std::shared_ptr<AsyncLogging> backend = std::make_shared<AsyncLogging>(file, true);
+    retire_async_logging(std::atomic_exchange(&async_logging, backend));
+    return true;
+}
 
-    std::string color;
-    std::string levelStr;
+// 关闭异步日志 写出剩余日志后恢复同步输出 可与其他线程写日志并发调用
+inline void stop_async_logging()
+{
+    retire_async_logging(std::atomic_exchange(&async_logging, std::shared_ptr<AsyncLogging>()));
+}
+
+// 阻塞直到此前的日志全部写入文件 未开启异步日志时直接返回
+inline void flush_async_logging()
+{
+    if (std::shared_ptr<AsyncLogging> backend = std::atomic_load(&async_logging))
+        backend->flush();
+}
+
+// 格式化当前时间 同一秒内复用上次的格式化结果 避免每条日志都调用localtime
+inline const char *log_time_str()
+{
+    thread_local time_t last_second = 0;
+    thread_local char time_str[32] = {0};
+
+    time_t now = time(nullptr);
+    if (now != last_second)
+    {
+        last_second = now;
+        struct tm local_time;
+        localtime_r(&now, &local_time);
+        strftime(time_str, sizeof(time_str), "[%Y-%m-%d %H:%M:%S] ", &local_time);
+    }
+    return time_str;
+}
+
+// 格式化并输出一条日志 调用前已完成级别过滤
+inline void log_write(int level, const char *msg, size_t msg_len, const char *file, int line)
+{
+    const char *color;
+    const char *levelStr;
 
     switch (level)
     {
@@ -81,10 +311,189 @@ void log_msg(int level, const std::string &msg, const std::string &file, int lin
         break;
     }
 
-    // 输出到终端，时间戳使用蓝色，日志级别使用指定颜色，消息本身使用默认颜色
-    std::cout << BLUE << timeStr << color << levelStr << RESET << msg << " (at " << file << ":" << line << ")" << RESET << std::endl;
+    // 在线程局部的定长缓冲区中格式化 不产生临时字符串
+    thread_local char buf[LOG_LINE_SIZE];
+    const char *timeStr = log_time_str();
+    int n = 0;
+    int len_arg = static_cast<int>(msg_len < LOG_LINE_SIZE ? msg_len : LOG_LINE_SIZE);
+    std::shared_ptr<AsyncLogging> backend = std::atomic_load(&async_logging); // 持有引用期间后端不会被释放
+    if (backend)
+    {
+        // 写入文件 不带颜色
+        n = snprintf(buf, sizeof(buf), "%s%s%.*s (at %s:%d)\n", timeStr, levelStr, len_arg, msg, file, line);
+    }
+    else
+    {
+        // 输出到终端，时间戳使用蓝色，日志级别使用指定颜色，消息本身使用默认颜色
+        n = snprintf(buf, sizeof(buf), BLUE "%s%s%s" RESET "%.*s (at %s:%d)" RESET "\n",
+                     timeStr, color, levelStr, len_arg, msg, file, line);
+    }
+
+    size_t len = n < 0 ? 0 : (static_cast<size_t>(n) < sizeof(buf) ? n : sizeof(buf) - 1);
+    if (len > 0 && buf[len - 1] != '\n')
+        buf[len - 1] = '\n'; // 被截断时保证以换行结尾
+
+    if (backend)
+    {
+        backend->append(buf, len);
+        if (level == FATAL)
+            backend->flush(); // 致命错误后进程通常立即退出 先写出全部日志
+        return;
+    }
+
+    // 同步输出 不再每行都刷新 终端为行缓冲 错误日志立即刷新
+    fwrite(buf, 1, len, stdout);
+    if (level >= ERROR)
+        fflush(stdout);
     // 写入到文件
     // logFile << timeStr << levelStr << msg << std::endl;
 }
 
-#define LOG_MSG(level, msg) log_msg(level, msg, __FILE__, __LINE__)
\ No newline at end of file
+inline void log_msg(int level, std::string_view msg, const char *file, int line)
+{
+    // 如果消息的级别低于当前级别，则不打印
+    if (level < current_level)
+        return;
+
+    log_write(level, msg.data(), msg.size(), file, line);
+}
+
+// 日志格式化器 把参数直接写入定长缓冲区 超出部分被截断
+// 每种参数类型对应一个append重载 不支持的类型在编译期报错
+class LogFormatter
+{
+public:
+    LogFormatter(char *buf, size_t capacity) : buf_(buf), capacity_(capacity), size_(0) {}
+
+    void append(std::string_view str)
+    {
+        size_t n = str.size() < capacity_ - size_ ? str.size() : capacity_ - size_;
+        memcpy(buf_ + size_, str.data(), n);
+        size_ += n;
+    }
+
+    void append(const char *str) { append(std::string_view(str ? str : "(null)")); }
+    void append(const std::string &str) { append(std::string_view(str)); }
+    void append(char c) { append(std::string_view(&c, 1)); }
+    void append(bool b) { append(std::string_view(b ? "true" : "false")); }
+
+    void append(const void *ptr)
+    {
+        char tmp[2 + 16];
+        int n = snprintf(tmp, sizeof(tmp), "%p", ptr);
+        append(std::string_view(tmp, n > 0 ? n : 0));
+    }
+
+    // 整数与浮点数 使用to_chars转换 不依赖locale 不申请内存
+    template <typename T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+    void append(T value)
+    {
+        char tmp[64];
+        std::to_chars_result result = std::to_chars(tmp, tmp + sizeof(tmp), value);
+        append(std::string_view(tmp, result.ptr - tmp));
+    }
+
+    // 枚举按底层整数输出
+    template <typename T, typename std::enable_if<std::is_enum<T>::value, int>::type = 0>
+    void append(T value) { append(static_cast<typename std::underlying_type<T>::type>(value)); }
+
+    // 依次用参数替换fmt中的"{}" "{{"和"}}"输出为单个花括号
+    // 占位符多于参数时原样输出 参数多于占位符时忽略多余参数
+    template <typename... Args>
+    void format(std::string_view fmt, const Args &...args)
+    {
+        size_t pos = 0;
+        (format_next(fmt, &pos, args), ...);
+        append_literal(fmt.substr(pos), nullptr);
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    // 输出下一个占位符之前的文本 然后输出参数arg
+    template <typename T>
+    void format_next(std::string_view fmt, size_t *pos, const T &arg)
+    {
+        if (*pos >= fmt.size())
+            return;
+
+        size_t placeholder = 0;
+        if (append_literal(fmt.substr(*pos), &placeholder))
+        {
+            *pos += placeholder + 2;
+            append(arg);
+        }
+        else
+        {
+            *pos = fmt.size();
+        }
+    }
+
+    // 输出文本直到遇到"{}" 找到时通过placeholder返回其偏移并返回true
+    bool append_literal(std::string_view text, size_t *placeholder)
+    {
+        size_t begin = 0;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            char c = text[i];
+            if (c != '{' && c != '}')
+                continue;
+
+            if (i + 1 < text.size() && text[i + 1] == c)
+            {
+                // 转义的花括号 输出一个
+                append(text.substr(begin, i + 1 - begin));
+                begin = ++i + 1;
+            }
+            else if (placeholder && c == '{' && i + 1 < text.size() && text[i + 1] == '}')
+            {
+                append(text.substr(begin, i - begin));
+                *placeholder = i;
+                return true;
+            }
+        }
+        append(text.substr(begin));
+        return false;
+    }
+
+private:
+    char *buf_;       // 目标缓冲区
+    size_t capacity_; // 缓冲区大小
+    size_t size_;     // 已写入大小
+};
+
+// 按格式串输出日志 格式化结果直接写入线程局部缓冲区
+template <typename... Args>
+inline void log_fmt(int level, const char *file, int line, std::string_view fmt, const Args &...args)
+{
+    if (level < current_level)
+        return;
+
+    thread_local char buf[LOG_LINE_SIZE];
+    LogFormatter formatter(buf, sizeof(buf));
+    formatter.format(fmt, args...);
+    log_write(level, buf, formatter.size(), file, line);
+}
+
+// 编译期最低日志级别 低于该级别的日志语句在编译时被整体移除 例如编译时指定-DLOG_MIN_LEVEL=INFO
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL DEBUG
+#endif
+
+// 级别判断在参数求值之前 被过滤的日志只有一次比较 不会构造消息字符串
+#define LOG_ENABLED(level) ((level) >= LOG_MIN_LEVEL && (level) >= current_level)
+
+#define LOG_MSG(level, msg)                                   \
+    do                                                        \
+    {                                                         \
+        if (LOG_ENABLED(level))                               \
+            log_msg(level, msg, __FILE__, __LINE__);          \
+    } while (0)
+
+// 类型安全的格式化日志 用参数依次替换格式串中的"{}" 例如LOG_FMT(WARN, "recv failed! errno={}", errno)
+#define LOG_FMT(level, ...)                                   \
+    do                                                        \
+    {                                                         \
+        if (LOG_ENABLED(level))                               \
+            log_fmt(level, __FILE__, __LINE__, __VA_ARGS__);  \
+    } while (0)
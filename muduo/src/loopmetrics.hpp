@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include <ctime>
+#include <cstdio>
+#include "bufferpool.hpp"
+#include "log.hpp"
+
+static const int METRIC_HISTOGRAM_BUCKETS = 32; // 直方图桶数 第i个桶记录[2^(i-1), 2^i)的值
+
+// 获取单调时钟的当前时间(纳秒) 用于统计耗时
+inline uint64_t metrics_now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 计数器增加n 计数器只由所属线程修改 用宽松的读后写代替原子加 避免总线锁
+inline void metric_add(std::atomic<uint64_t> &counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// 计数器减少n 规则同metric_add
+inline void metric_sub(std::atomic<uint64_t> &counter, uint64_t n)
+{
+    counter.store(counter.load(std::memory_order_relaxed) - n, std::memory_order_relaxed);
+}
+
+// 按2的幂分桶的直方图 只由所属线程记录 可在任意线程读取 读取到的各桶之间不保证一致
+class MetricHistogram
+{
+public:
+    MetricHistogram() : count_(0), sum_(0), max_(0)
+    {
+        for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+            buckets_[i].store(0, std::memory_order_relaxed);
+    }
+
+    MetricHistogram(const MetricHistogram &) = delete;
+    MetricHistogram &operator=(const MetricHistogram &) = delete;
+
+    // 记录一个值
+    void record(uint64_t value)
+    {
+        metric_add(buckets_[bucket_of(value)], 1);
+        metric_add(count_, 1);
+        metric_add(sum_, value);
+        if (value > max_.load(std::memory_order_relaxed))
+            max_.store(value, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); } // 记录次数
+    uint64_t sum() const { return sum_.load(std::memory_order_relaxed); }     // 记录值之和
+    uint64_t max() const { return max_.load(std::memory_order_relaxed); }     // 最大值
+
+    // 近似百分位数 p取值0~1 返回所在桶的上界 不超过最大值
+    uint64_t percentile(double p) const
+    {
+        uint64_t total = count();
+        if (total == 0)
+            return 0;
+
+        uint64_t rank = static_cast<uint64_t>(p * total);
+        uint64_t seen = 0;
+        for (int i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+        {
+            seen += buckets_[i].load(std::memory_order_relaxed);
+            if (seen > rank)
+            {
+                uint64_t upper = i == 0 ? 0 : (1ull << i) - 1;
+                return upper < max() ? upper : max();
+            }
+        }
+        return max();
+    }
+
+private:
+    static int bucket_of(uint64_t value)
+    {
+        if (value == 0)
+            return 0;
+        int bucket = 64 - __builtin_clzll(value);
+        return bucket < METRIC_HISTOGRAM_BUCKETS ? bucket : METRIC_HISTOGRAM_BUCKETS - 1;
+    }
+
+private:
+    std::atomic<uint64_t> buckets_[METRIC_HISTOGRAM_BUCKETS]; // 各桶计数
+    std::atomic<uint64_t> count_;                             // 记录次数
+    std::atomic<uint64_t> sum_;                               // 记录值之和
+    std::atomic<uint64_t> max_;                               // 最大值
+};
+
+// 事件循环运行统计 每个事件循环持有一个
+// 除唤醒次数外都只由事件循环线程修改 其他线程可随时读取
+struct LoopMetrics
+{
+    std::atomic<uint64_t> wakeups{0};           // poll返回次数
+    std::atomic<uint64_t> events{0};            // 就绪事件总数
+    std::atomic<uint64_t> wait_ns{0};           // 阻塞在poll中的时间
+    std::atomic<uint64_t> busy_ns{0};           // 处理就绪事件和任务的时间
+    std::atomic<uint64_t> tasks{0};             // 执行的任务数
+    std::atomic<uint64_t> wakeup_writes{0};     // 写eventfd唤醒的次数 由投递方原子累加
+    std::atomic<uint64_t> bytes_in{0};          // 连接读入的字节数
+    std::atomic<uint64_t> bytes_out{0};         // 连接写出的字节数
+    std::atomic<uint64_t> connections{0};       // 当前连接数
+    MetricHistogram events_per_wakeup;          // 每次唤醒的就绪事件数
+    MetricHistogram busy_us;                    // 每轮处理事件和任务的耗时(微秒)
+    MetricHistogram timer_late_us;              // 定时器实际执行时间晚于到期时间的量(微秒)
+    MetricHistogram task_batch;                 // 每轮取出的任务数 即执行时任务队列的深度
+
+    // 记录一轮循环 wait为poll耗时(纳秒) busy为处理耗时(纳秒) count为就绪事件数
+    void record_iteration(uint64_t wait, uint64_t busy, size_t count)
+    {
+        metric_add(wakeups, 1);
+        metric_add(events, count);
+        metric_add(wait_ns, wait);
+        metric_add(busy_ns, busy);
+        events_per_wakeup.record(count);
+        busy_us.record(busy / 1000);
+    }
+};
+
+// 输出一个计数器 格式为"前缀.名称 值" 每项一行
+inline void format_metric(std::string *out, const std::string &prefix, const char *name, uint64_t value)
+{
+    char line[256];
+    int n = snprintf(line, sizeof(line), "%s.%s %lu\n", prefix.c_str(), name, static_cast<unsigned long>(value));
+    if (n > 0)
+        out->append(line, static_cast<size_t>(n) < sizeof(line) ? n : sizeof(line) - 1);
+}
+
+// 输出一个直方图的次数 p50 p99 p999和最大值
+inline void format_histogram(std::string *out, const std::string &prefix, const char *name, const MetricHistogram &histogram)
+{
+    std::string base = prefix + "." + name;
+    format_metric(out, base, "count", histogram.count());
+    format_metric(out, base, "p50", histogram.percentile(0.5));
+    format_metric(out, base, "p99", histogram.percentile(0.99));
+    format_metric(out, base, "p999", histogram.percentile(0.999));
+    format_metric(out, base, "max", histogram.max());
+}
+
+// 将事件循环统计格式化为纯文本 每项一行 prefix通常为"loop0"这样的事件循环名称
+inline void format_loop_metrics(std::string *out, const std::string &prefix, const LoopMetrics &metrics, const BufferPoolStats &pool)
+{
+    format_metric(out, prefix, "wakeups", metrics.wakeups.load(std::memory_order_relaxed));
+    format_metric(out, prefix, "events", metrics.events.load(std::memory_order_relaxed));
+    format_histogram(out, prefix, "events_per_wakeup", metrics.events_per_wakeup);
+    format_metric(out, prefix, "wait_ms", metrics.wait_ns.load(std::memory_order_relaxed) / 1000000);
+    format_metric(out, prefix, "busy_ms", metrics.busy_ns.load(std::memory_order_relaxed) / 1000000);
+    format_histogram(out, prefix, "busy_us", metrics.busy_us);
+    format_metric(out, prefix, "tasks", metrics.tasks.load(std::memory_order_relaxed));
+    format_histogram(out, prefix, "task_batch", metrics.task_batch);
+    format_metric(out, prefix, "wakeup_writes", metrics.wakeup_writes.load(std::memory_order_relaxed));
+    format_metric(out, prefix, "bytes_in", metrics.bytes_in.load(std::memory_order_relaxed));
+    format_metric(out, prefix, "bytes_out", metrics.bytes_out.load(std::memory_order_relaxed));
+    format_metric(out, prefix, "connections", metrics.connections.load(std::memory_order_relaxed));
+    format_metric(out, prefix, "buffer_in_use_bytes", pool.in_use_bytes.load(std::memory_order_relaxed));
+    format_metric(out, prefix, "buffer_cached_bytes", pool.cached_bytes.load(std::memory_order_relaxed));
+    format_histogram(out, prefix, "timer_late_us", metrics.timer_late_us);
+}
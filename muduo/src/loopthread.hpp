@@ -0,0 +1,159 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "eventloop.hpp"
+#include "log.hpp"
+
+using thread_init_callback = std::function<void(EventLoop *)>; // 线程启动后在事件循环中执行的初始化回调
+
+// 运行一个事件循环的线程 one loop per thread
+class EventLoopThread
+{
+public:
+    EventLoopThread(const thread_init_callback &cb = thread_init_callback())
+        : loop_(nullptr), init_callback_(cb) {}
+
+    // 析构函数 退出事件循环并等待线程结束
+    ~EventLoopThread()
+    {
+        if (thread_.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (loop_)
+                    loop_->quit();
+            }
+            thread_.join();
+        }
+    }
+
+    EventLoopThread(const EventLoopThread &) = delete;
+    EventLoopThread &operator=(const EventLoopThread &) = delete;
+
+    // 启动线程 阻塞直到线程中的事件循环创建完毕
+    EventLoop *start()
+    {
+        thread_ = std::thread(std::bind(&EventLoopThread::thread_entry, this));
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        cond_.wait(lock, [this]()
+                   { return loop_ != nullptr; });
+        return loop_;
+    }
+
+private:
+    // 线程入口 事件循环在线程栈上创建 保证其与线程绑定
+    void thread_entry()
+    {
+        EventLoop loop;
+        if (init_callback_)
+            init_callback_(&loop);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            loop_ = &loop;
+        }
+        cond_.notify_one();
+
+        loop.loop();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        loop_ = nullptr;
+    }
+
+private:
+    EventLoop *loop_;                    // 线程中运行的事件循环
+    std::thread thread_;                 // 线程
+    std::mutex mutex_;                   // 保护loop_
+    std::condition_variable cond_;       // 等待事件循环创建完毕
+    thread_init_callback init_callback_; // 初始化回调函数
+};
+
+// 事件循环线程池 主事件循环负责监听 从事件循环负责处理连接
+class EventLoopThreadPool
+{
+public:
+    EventLoopThreadPool(EventLoop *base_loop) : base_loop_(base_loop), thread_count_(0), next_(0), started_(false) {}
+
+    EventLoopThreadPool(const EventLoopThreadPool &) = delete;
+    EventLoopThreadPool &operator=(const EventLoopThreadPool &) = delete;
+
+    // 设置线程数量 0表示所有连接都在主事件循环中处理
+    void set_thread_count(int count) { thread_count_ = count; }
+
+    // 启动所有线程 cb在每个事件循环线程中执行一次
+    void start(const thread_init_callback &cb = thread_init_callback())
+    {
+        base_loop_->assert_in_loop();
+        assert(!started_);
+        started_ = true;
+
+        for (int i = 0; i < thread_count_; i++)
+        {
+            threads_.emplace_back(new EventLoopThread(cb));
+            loops_.push_back(threads_.back()->start());
+        }
+
+        // 没有从线程时由主事件循环承担全部工作
+        if (thread_count_ == 0 && cb)
+            cb(base_loop_);
+    }
+
+    // 轮询获取下一个事件循环
+    EventLoop *next_loop()
+    {
+        base_loop_->assert_in_loop();
+        if (loops_.empty())
+            return base_loop_;
+
+        EventLoop *loop = loops_[next_];
+        next_ = (next_ + 1) % loops_.size();
+        return loop;
+    }
+
+    // 获取负载最小的事件循环 负载相同时按轮询顺序选择
+    EventLoop *least_loaded_loop()
+    {
+        base_loop_->assert_in_loop();
+        if (loops_.empty())
+            return base_loop_;
+
+        size_t best = next_;
+        size_t best_load = loops_[best]->load();
+        for (size_t i = 1; i < loops_.size(); i++)
+        {
+            size_t index = (next_ + i) % loops_.size();
+            size_t load = loops_[index]->load();
+            if (load < best_load)
+            {
+                best = index;
+                best_load = load;
+            }
+        }
+        next_ = (best + 1) % loops_.size();
+        return loops_[best];
+    }
+
+    // 获取所有处理连接的事件循环
+    std::vector<EventLoop *> all_loops() const
+    {
+        if (loops_.empty())
+            return std::vector<EventLoop *>(1, base_loop_);
+        return loops_;
+    }
+
+    bool started() const { return started_; }
+
+private:
+    EventLoop *base_loop_;                                  // 主事件循环
+    int thread_count_;                                      // 线程数量
+    size_t next_;                                           // 下一个被选择的事件循环下标
+    bool started_;                                          // 是否已启动
+    std::vector<std::unique_ptr<EventLoopThread>> threads_; // 事件循环线程
+    std::vector<EventLoop *> loops_;                        // 从事件循环
+};
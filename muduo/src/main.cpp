@@ -1,6 +1,29 @@
-#include "channel.hpp"
+#include <cstring>
+#include "eventloop.hpp"
 
 int main()
 {
+    EventLoop loop;
+
+    // 监控标准输入 回显输入内容 输入exit时退出事件循环
+    CallbackChannel stdin_channel(&loop, STDIN_FILENO);
+    stdin_channel.set_read_callback([&]()
+                                    {
+        char buf[1024] = {0};
+        ssize_t n = read(STDIN_FILENO, buf, sizeof(buf) - 1);
+        if (n <= 0 || strstr(buf, "exit") != nullptr)
+        {
+            stdin_channel.remove();
+            loop.quit();
+            return;
+        }
+        LOG_FMT(INFO, "echo: {}", std::string_view(buf, n)); });
+    stdin_channel.set_close_callback([&]()
+                                     {
+        stdin_channel.remove();
+        loop.quit(); }); // 标准输入被关闭
+    stdin_channel.enable_read();
+
+    loop.loop();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <utility>
+#include "log.hpp"
+
+// 无锁多生产者单消费者队列 基于侵入式链表(Vyukov MPSC)
+// 生产者只做一次原子交换和一次release写入 任意线程可并发push 不会阻塞
+// 只有所属线程可以pop 与push之间无需加锁
+// 某个生产者交换头指针后尚未链接节点时 消费者暂时看不到该节点及其后的节点
+// 该生产者链接完成后必然会执行唤醒检查 因此不会丢失任务
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head_(&stub_), tail_(&stub_) { stub_.next.store(nullptr, std::memory_order_relaxed); }
+
+    // 析构时释放尚未取出的元素 此时不能再有生产者
+    ~MpscQueue()
+    {
+        T value;
+        while (pop(&value))
+            ;
+        if (tail_ != &stub_)
+            delete tail_;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    // 压入元素 可在任意线程调用
+    void push(T value)
+    {
+        Node *node = new Node(std::move(value));
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // 取出元素 只能在消费者线程调用 队列为空或队首尚未链接完成时返回false
+    bool pop(T *value)
+    {
+        Node *tail = tail_;
+        Node *next = tail->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+            return false;
+
+        // next成为新的哑节点 其中的值被取走
+        *value = std::move(next->value);
+        next->value = T(); // 立即释放元素持有的资源 不等到节点被释放
+        tail_ = next;
+        if (tail != &stub_)
+            delete tail;
+        return true;
+    }
+
+    // 判断队列是否为空 只能在消费者线程调用 结果只是一个提示
+    bool empty() const { return tail_->next.load(std::memory_order_acquire) == nullptr; }
+
+private:
+    struct Node
+    {
+        Node() = default;
+        explicit Node(T &&v) : next(nullptr), value(std::move(v)) {}
+
+        std::atomic<Node *> next{nullptr}; // 下一个节点
+        T value;                           // 元素
+    };
+
+private:
+    Node stub_;                            // 初始哑节点 不会被释放
+    alignas(64) std::atomic<Node *> head_; // 最后压入的节点 生产者之间竞争 与消费者分处不同缓存行
+    alignas(64) Node *tail_;               // 当前哑节点 其后为第一个元素 只由消费者访问
+};
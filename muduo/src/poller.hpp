@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include "channel.hpp"
+
+// 描述符事件监控的抽象接口 每个事件循环持有一个 只能在所属线程中使用
+// Channel的监控事件与就绪事件统一使用EPOLLIN/EPOLLOUT等取值 各实现负责与底层机制之间的转换
+class Poller
+{
+public:
+    Poller() = default;
+    virtual ~Poller() = default;
+
+    Poller(const Poller &) = delete;
+    Poller &operator=(const Poller &) = delete;
+
+    // 实现名称
+    virtual const char *name() const = 0;
+
+    // 添加或修改描述符的监控事件
+    virtual void update_event(Channel *channel) = 0;
+
+    // 移除描述符的监控
+    virtual void remove_event(Channel *channel) = 0;
+
+    // 开始监控 就绪的Channel追加到active中 timeout: 超时时间(毫秒) -1表示阻塞
+    virtual void poll(std::vector<Channel *> *active, int timeout) = 0;
+
+    // 判断描述符是否在监控中
+    bool has_channel(Channel *channel) const
+    {
+        auto it = channels_.find(channel->fd());
+        return it != channels_.end() && it->second == channel;
+    }
+
+    // 监控数量
+    size_t channel_count() const { return channels_.size(); }
+
+protected:
+    std::unordered_map<int, Channel *> channels_; // 描述符与Channel的映射
+};
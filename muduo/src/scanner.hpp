@@ -0,0 +1,203 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <cassert>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#define SCANNER_X86 1
+#endif
+
+// 向量化分隔符扫描 x86上按运行时CPU能力选择AVX2或SSE2实现 其他平台使用标量实现
+// 所有函数在[begin, end)中查找 未找到时返回end
+
+static const size_t SCANNER_MAX_DELIMS = 8; // 分隔符集合最多包含的字符数
+
+// 分隔符集合 同时保存标量查找表和向量比较所需的字符
+class DelimiterSet
+{
+public:
+    DelimiterSet(const char *delims) : count_(0)
+    {
+        memset(table_, 0, sizeof(table_));
+        for (; *delims; delims++)
+        {
+            assert(count_ < SCANNER_MAX_DELIMS);
+            table_[static_cast<unsigned char>(*delims)] = true;
+            chars_[count_++] = *delims;
+        }
+    }
+
+    bool contains(char c) const { return table_[static_cast<unsigned char>(c)]; }
+    size_t count() const { return count_; }
+    char at(size_t i) const { return chars_[i]; }
+
+private:
+    bool table_[256];                // 标量查找表
+    char chars_[SCANNER_MAX_DELIMS]; // 分隔符字符
+    size_t count_;                   // 分隔符数量
+};
+
+// 标量实现 用于不支持SIMD的平台以及向量实现处理尾部剩余数据
+inline const char *scan_char_scalar(const char *p, const char *end, char c)
+{
+    for (; p < end; p++)
+        if (*p == c)
+            return p;
+    return end;
+}
+
+inline const char *scan_crlf_scalar(const char *p, const char *end)
+{
+    for (; p + 1 < end; p++)
+        if (p[0] == '\r' && p[1] == '\n')
+            return p;
+    return end;
+}
+
+inline const char *scan_any_scalar(const char *p, const char *end, const DelimiterSet &set)
+{
+    for (; p < end; p++)
+        if (set.contains(*p))
+            return p;
+    return end;
+}
+
+#ifdef SCANNER_X86
+
+// SSE2实现 x86_64上始终可用 每次比较16字节
+inline const char *scan_char_sse2(const char *p, const char *end, char c)
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_char_scalar(p, end, c);
+}
+
+// 同时比较位置i处的'\r'和位置i+1处的'\n' 两个掩码相与即为CRLF起始位置
+inline const char *scan_crlf_sse2(const char *p, const char *end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    for (; end - p >= 17; p += 16)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 1));
+        int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, cr), _mm_cmpeq_epi8(b, lf)));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_crlf_scalar(p, end);
+}
+
+inline const char *scan_any_sse2(const char *p, const char *end, const DelimiterSet &set)
+{
+    __m128i needles[SCANNER_MAX_DELIMS];
+    for (size_t i = 0; i < set.count(); i++)
+        needles[i] = _mm_set1_epi8(set.at(i));
+
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i hit = _mm_setzero_si128();
+        for (size_t i = 0; i < set.count(); i++)
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(chunk, needles[i]));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_any_scalar(p, end, set);
+}
+
+// AVX2实现 每次比较32字节 仅在运行时检测到CPU支持时调用
+__attribute__((target("avx2"))) inline const char *scan_char_avx2(const char *p, const char *end, char c)
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_char_sse2(p, end, c);
+}
+
+__attribute__((target("avx2"))) inline const char *scan_crlf_avx2(const char *p, const char *end)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    for (; end - p >= 33; p += 32)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + 1));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf))));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_crlf_sse2(p, end);
+}
+
+__attribute__((target("avx2"))) inline const char *scan_any_avx2(const char *p, const char *end, const DelimiterSet &set)
+{
+    __m256i needles[SCANNER_MAX_DELIMS];
+    for (size_t i = 0; i < set.count(); i++)
+        needles[i] = _mm256_set1_epi8(set.at(i));
+
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i hit = _mm256_setzero_si256();
+        for (size_t i = 0; i < set.count(); i++)
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(chunk, needles[i]));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    return scan_any_sse2(p, end, set);
+}
+
+// CPU是否支持AVX2 只检测一次
+inline bool scanner_has_avx2()
+{
+    static const bool has_avx2 = __builtin_cpu_supports("avx2");
+    return has_avx2;
+}
+
+#endif
+
+// 查找字符c
+inline const char *scan_char(const char *begin, const char *end, char c)
+{
+#ifdef SCANNER_X86
+    return scanner_has_avx2() ? scan_char_avx2(begin, end, c) : scan_char_sse2(begin, end, c);
+#else
+    return scan_char_scalar(begin, end, c);
+#endif
+}
+
+// 查找"\r\n" 返回'\r'的位置
+inline const char *scan_crlf(const char *begin, const char *end)
+{
+#ifdef SCANNER_X86
+    return scanner_has_avx2() ? scan_crlf_avx2(begin, end) : scan_crlf_sse2(begin, end);
+#else
+    return scan_crlf_scalar(begin, end);
+#endif
+}
+
+// 查找分隔符集合中任意一个字符
+inline const char *scan_any(const char *begin, const char *end, const DelimiterSet &set)
+{
+#ifdef SCANNER_X86
+    return scanner_has_avx2() ? scan_any_avx2(begin, end, set) : scan_any_sse2(begin, end, set);
+#else
+    return scan_any_scalar(begin, end, set);
+#endif
+}
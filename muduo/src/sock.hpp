@@ -7,6 +7,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include "log.hpp"
 #include <fcntl.h>
@@ -19,13 +20,13 @@ public:
     Socket() : sockfd_(-1) {} // 构造函数
     Socket(int sockfd) : sockfd_(sockfd) {}
     ~Socket() { Close(); }          // 析构函数
-    int GetFd() { return sockfd_; } // 获取文件描述符
+    int GetFd() const { return sockfd_; } // 获取文件描述符
 
-    // 创建套接字
-    bool Create()
+    // 创建套接字 type: SOCK_STREAM创建TCP套接字 SOCK_DGRAM创建UDP套接字
+    bool Create(int type = SOCK_STREAM)
     {
-        // AF_INET: IPv4协议 SOCK_STREAM: 流式套接字 IPPROTO_TCP: TCP协议
-        sockfd_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        // AF_INET: IPv4协议 SOCK_STREAM: 流式套接字 SOCK_DGRAM: 数据报套接字
+        sockfd_ = socket(AF_INET, type, type == SOCK_DGRAM ? IPPROTO_UDP : IPPROTO_TCP);
         if (sockfd_ == -1)
         {
             LOG_MSG(ERROR, "create socket failed!");
@@ -89,6 +90,45 @@ public:
         return true;
     }
 
+    // 非阻塞地向服务器发起连接 套接字需已设置为非阻塞 成功或正在连接(EINPROGRESS)时返回0
+    // 失败返回-1并通过saved_errno返回错误码 不记录日志 由调用者决定是否重试
+    int ConnectNonBlock(const std::string &ip, int port, int *saved_errno)
+    {
+        struct sockaddr_in server_addr;
+        bzero(&server_addr, sizeof(server_addr)); // 清空结构体
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        server_addr.sin_addr.s_addr = inet_addr(ip.c_str());
+
+        if (connect(sockfd_, (struct sockaddr *)&server_addr, sizeof(server_addr)) == -1 && errno != EINPROGRESS)
+        {
+            *saved_errno = errno;
+            return -1;
+        }
+        return 0;
+    }
+
+    // 获取并清除套接字上待处理的错误 非阻塞连接可写后以此判断连接是否成功
+    int GetError()
+    {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(sockfd_, SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+            return errno;
+        return err;
+    }
+
+    // 判断是否连接到了自身 本地端口与目标端口相同且连接失败时内核可能完成TCP同时打开
+    bool IsSelfConnect()
+    {
+        struct sockaddr_in local, peer;
+        socklen_t local_len = sizeof(local), peer_len = sizeof(peer);
+        if (getsockname(sockfd_, (struct sockaddr *)&local, &local_len) == -1 ||
+            getpeername(sockfd_, (struct sockaddr *)&peer, &peer_len) == -1)
+            return false;
+        return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+    }
+
     // 接受客户端连接
     int Accept()
     {
@@ -96,17 +136,38 @@ public:
         bzero(&client_addr, sizeof(client_addr)); // 清空结构体
         socklen_t addr_len = sizeof(client_addr);
 
-        int client_sockfd = accept(sockfd_, (struct sockaddr *)&client_addr, &addr_len);
+        int client_sockfd = accept4(sockfd_, (struct sockaddr *)&client_addr, &addr_len, SOCK_CLOEXEC);
         if (client_sockfd == -1)
         {
             LOG_MSG(ERROR, "accept socket failed!");
             return -1;
         }
 
-        LOG_MSG(DEBUG, "accept socket success!");
         return client_sockfd;
     }
 
+    // 非阻塞地接受客户端连接 新连接为非阻塞且设置CLOEXEC 失败返回-1并通过saved_errno返回错误码
+    // 不记录日志 由调用者区分EAGAIN等可预期的错误
+    int Accept4(int *saved_errno)
+    {
+        int client_sockfd = accept4(sockfd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_sockfd == -1)
+            *saved_errno = errno;
+        return client_sockfd;
+    }
+
+    // 复制监听套接字 新描述符与原描述符共享同一个监听队列 失败返回false
+    bool DupFrom(const Socket &other)
+    {
+        sockfd_ = fcntl(other.GetFd(), F_DUPFD_CLOEXEC, 0);
+        if (sockfd_ == -1)
+        {
+            LOG_MSG(ERROR, "dup socket failed!");
+            return false;
+        }
+        return true;
+    }
+
     // 接收数据 flag: 0-阻塞接收
     ssize_t Recv(void *buf, size_t len, int flag = 0)
     {
@@ -116,7 +177,7 @@ public:
             // 非阻塞模式下，EAGAIN表示没有数据可读，EINTR表示被信号中断
             if (errno == EAGAIN || errno == EINTR)
             {
-                LOG_MSG(WARN, "recv data failed!" + std::to_string(errno));
+                LOG_FMT(WARN, "recv data failed! errno={}", errno);
                 return 0;
             }
             else
@@ -158,6 +219,14 @@ public:
         return Send(buf, len, MSG_DONTWAIT);
     }
 
+    // 交出描述符的所有权 之后析构时不再关闭
+    int Release()
+    {
+        int fd = sockfd_;
+        sockfd_ = -1;
+        return fd;
+    }
+
     // 获取socket文件描述符
     void Close()
     {
@@ -180,18 +249,47 @@ public:
     void ReuseAddr()
     {
         int opt = 1;
-        // SO_REUSEADDR: 允许重用本地地址 SO_REUSEPORT: 允许重用本地端口
-        setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR | SO_REUSEPORT, &opt, sizeof(opt));
+        // SO_REUSEADDR: 允许重用本地地址 选项名不能按位或 需分别设置
+        setsockopt(sockfd_, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
         LOG_MSG(DEBUG, "set reuseaddr success!");
     }
 
-    // 创建服务端连接
-    bool CreateServer(int port, const std::string &ip = "0.0.0.0")
+    // 设置端口复用 多个套接字可绑定同一端口 由内核在它们之间分发新连接
+    bool ReusePort()
+    {
+        int opt = 1;
+        // SO_REUSEPORT: 允许重用本地端口
+        if (setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1)
+        {
+            LOG_MSG(ERROR, "set reuseport failed!");
+            return false;
+        }
+
+        LOG_MSG(DEBUG, "set reuseport success!");
+        return true;
+    }
+
+    // 设置TCP_NODELAY 关闭Nagle算法 小数据立即发送 适合请求应答式的交互
+    void NoDelay(bool on = true)
+    {
+        int opt = on ? 1 : 0;
+        if (setsockopt(sockfd_, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt)) == -1)
+            LOG_MSG(ERROR, "set nodelay failed!");
+    }
+
+    // 创建服务端连接 reuse_port: 是否开启端口复用 nonblock: 是否设置为非阻塞
+    bool CreateServer(int port, const std::string &ip = "0.0.0.0", bool reuse_port = false, bool nonblock = false)
     {
         if (!Create())
             return false;
 
-        // NonBlock(); // 设置非阻塞模式
+        if (nonblock)
+            NonBlock(); // 设置非阻塞模式
+
+        ReuseAddr(); // 设置地址复用 必须在bind之前设置才能生效
+
+        if (reuse_port && !ReusePort())
+            return false;
 
         if (!Bind(ip, port))
             return false;
@@ -199,23 +297,22 @@ public:
         if (!Listen())
             return false;
 
-        ReuseAddr(); // 设置地址复用
-
         LOG_MSG(INFO, "create server success!");
         return true;
     }
 
-    // 创建客户端连接
+    // 创建客户端连接 阻塞地完成连接后再设置为非阻塞模式
+    // 非阻塞模式下connect总是返回EINPROGRESS 事件循环中应使用Connector异步连接
     bool CreateClient(const std::string &ip, int port)
     {
         if (!Create())
             return false;
 
-        NonBlock(); // 设置非阻塞模式
-
         if (!Connect(ip, port))
             return false;
 
+        NonBlock(); // 设置非阻塞模式
+
         LOG_MSG(INFO, "create client success!");
         return true;
     }
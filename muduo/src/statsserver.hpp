@@ -0,0 +1,73 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include "eventloop.hpp"
+#include "tcpserver.hpp"
+#include "log.hpp"
+
+// 运行统计服务 收到请求后返回所有登记的事件循环的统计文本并关闭连接
+// 请求以GET开头时按HTTP/1.0应答 可以直接用curl访问 其他请求返回纯文本 可以用nc访问
+// 服务本身运行在loop上 默认只监听回环地址
+class StatsServer
+{
+public:
+    StatsServer(EventLoop *loop, int port, const std::string &ip = "127.0.0.1")
+        : server_(loop, port, AcceptMode::MAIN_ACCEPTOR, ip)
+    {
+        server_.set_message_callback(std::bind(&StatsServer::on_message, this, std::placeholders::_1, std::placeholders::_2));
+    }
+
+    StatsServer(const StatsServer &) = delete;
+    StatsServer &operator=(const StatsServer &) = delete;
+
+    // 登记需要统计的事件循环 按登记顺序命名为loop0 loop1... 可在任意线程调用
+    void add_loop(EventLoop *loop)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loops_.push_back(loop);
+    }
+
+    void add_loops(const std::vector<EventLoop *> &loops)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loops_.insert(loops_.end(), loops.begin(), loops.end());
+    }
+
+    // 开始监听 必须在loop线程中调用
+    void start() { server_.start(); }
+
+    // 所有登记的事件循环的统计文本 可在任意线程调用
+    std::string stats_text()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        std::string text;
+        for (size_t i = 0; i < loops_.size(); i++)
+            text += loops_[i]->metrics_text("loop" + std::to_string(i));
+        return text;
+    }
+
+private:
+    // 收到任意数据即视为一次请求 应答后关闭写端
+    void on_message(const TcpConnectionPtr &conn, Buffer *buffer)
+    {
+        bool http = buffer->readable_size() >= 4 && memcmp(buffer->begin_read(), "GET ", 4) == 0;
+        buffer->move_read_off(buffer->readable_size());
+
+        std::string body = stats_text();
+        if (http)
+        {
+            std::string header = "HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\nContent-Length: " +
+                                 std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n";
+            conn->send(header);
+        }
+        conn->send(body);
+        conn->shutdown();
+    }
+
+private:
+    TcpServer server_;               // 统计服务使用的服务器
+    std::mutex mutex_;               // 保护loops_
+    std::vector<EventLoop *> loops_; // 登记的事件循环
+};
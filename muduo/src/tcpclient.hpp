@@ -0,0 +1,291 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include "eventloop.hpp"
+#include "connector.hpp"
+#include "tcpconnection.hpp"
+#include "log.hpp"
+
+static const size_t CLIENT_MAX_CONNECTIONS = 64; // 每个上游地址默认的最大连接数
+static const size_t CLIENT_MAX_IDLE = 16;        // 每个上游地址默认保留的最大空闲连接数
+static const int CLIENT_CONNECT_RETRIES = 3;     // 建立连接时默认的最大重试次数
+
+using acquire_callback = std::function<void(const TcpConnectionPtr &)>; // 获取连接回调 连接失败时参数为空
+
+// 客户端连接池 按上游地址保持已建立的连接 请求之间复用 省去每个请求的TCP握手
+// acquire优先取最近归还的空闲连接 没有空闲连接且未达上限时通过Connector异步建立新连接 否则排队等待归还
+// 连接池与一个事件循环绑定 所有方法都在该线程中调用 无需加锁 每个IO线程应各自持有一个连接池
+class TcpClient
+{
+public:
+    TcpClient(EventLoop *loop)
+        : loop_(loop), next_conn_id_(1), max_connections_(CLIENT_MAX_CONNECTIONS), max_idle_(CLIENT_MAX_IDLE),
+          max_retries_(CLIENT_CONNECT_RETRIES), init_retry_ms_(CONNECTOR_INIT_RETRY_MS), max_retry_ms_(CONNECTOR_MAX_RETRY_MS),
+          connect_timeout_ms_(0), no_delay_(false) {}
+
+    // 析构函数 停止正在进行的连接 销毁所有连接 等待中的请求以失败回调 必须在所属事件循环线程中析构
+    ~TcpClient()
+    {
+        loop_->assert_in_loop();
+        for (auto &kv : connectors_)
+            kv.second->stop();
+        connectors_.clear();
+
+        for (auto &kv : connections_)
+            kv.second.conn->connect_destroyed();
+        connections_.clear();
+
+        for (auto &kv : upstreams_)
+        {
+            std::deque<acquire_callback> waiters;
+            waiters.swap(kv.second->waiters);
+            for (acquire_callback &cb : waiters)
+                cb(TcpConnectionPtr());
+        }
+    }
+
+    TcpClient(const TcpClient &) = delete;
+    TcpClient &operator=(const TcpClient &) = delete;
+
+    // 以下回调作用于池中所有连接 归还连接时恢复为这里设置的消息回调
+    void set_connection_callback(const connection_callback &cb) { connection_callback_ = cb; }             // 连接建立或断开
+    void set_message_callback(const message_callback &cb) { message_callback_ = cb; }                      // 收到数据
+    void set_write_complete_callback(const write_complete_callback &cb) { write_complete_callback_ = cb; } // 输出缓冲区发送完毕
+
+    void set_max_connections(size_t count) { max_connections_ = count > 0 ? count : 1; } // 每个上游地址的最大连接数
+    void set_max_idle(size_t count) { max_idle_ = count; }                               // 每个上游地址保留的最大空闲连接数
+    void set_tcp_no_delay(bool on) { no_delay_ = on; }                                   // 新连接是否开启TCP_NODELAY
+
+    // 设置建立连接时的重试策略 见Connector
+    void set_retry_delay(uint64_t init_ms, uint64_t max_ms)
+    {
+        init_retry_ms_ = init_ms;
+        max_retry_ms_ = max_ms;
+    }
+    void set_max_retries(int count) { max_retries_ = count; }
+    void set_connect_timeout(uint64_t timeout_ms) { connect_timeout_ms_ = timeout_ms; }
+
+    EventLoop *owner_loop() const { return loop_; }
+
+    // 获取到上游地址的连接 取得后以连接回调 连接失败时以空指针回调
+    // 有空闲连接时在本次调用中直接回调 使用完毕后需通过release归还
+    // 取得的连接可临时设置自己的消息回调 归还时恢复为连接池的回调
+    void acquire(const std::string &ip, int port, const acquire_callback &cb)
+    {
+        loop_->assert_in_loop();
+        Upstream *upstream = find_upstream(ip, port);
+        while (!upstream->idle.empty())
+        {
+            // 后进先出 最近使用过的连接更可能仍然有效 多余的连接自然空闲
+            TcpConnectionPtr conn = upstream->idle.back();
+            upstream->idle.pop_back();
+            if (conn->connected())
+            {
+                cb(conn);
+                return;
+            }
+        }
+
+        upstream->waiters.push_back(cb);
+        if (upstream->waiters.size() > upstream->connecting && upstream->connections + upstream->connecting < max_connections_)
+            connect(upstream);
+    }
+
+    // 归还连接 有等待的请求时直接转交 否则放回空闲列表 已断开的连接由关闭回调清理
+    void release(const TcpConnectionPtr &conn)
+    {
+        loop_->assert_in_loop();
+        auto it = connections_.find(conn->id());
+        if (it == connections_.end() || !conn->connected())
+            return;
+
+        conn->set_message_callback(message_callback_);
+        hand_out(it->second.upstream, conn);
+    }
+
+    // 预先建立count个到上游地址的连接 建立后放入空闲列表
+    void warm_up(const std::string &ip, int port, size_t count)
+    {
+        loop_->assert_in_loop();
+        Upstream *upstream = find_upstream(ip, port);
+        for (size_t i = 0; i < count && upstream->connections + upstream->connecting < max_connections_; i++)
+            connect(upstream);
+    }
+
+    // 到上游地址的空闲连接数
+    size_t idle_count(const std::string &ip, int port) { return find_upstream(ip, port)->idle.size(); }
+
+    // 到上游地址的已建立连接数 包括空闲和使用中的连接
+    size_t connection_count(const std::string &ip, int port) { return find_upstream(ip, port)->connections; }
+
+private:
+    // 上游地址及其连接
+    struct Upstream
+    {
+        Upstream(const std::string &ip, int port) : ip(ip), port(port), connections(0), connecting(0) {}
+
+        std::string ip;                       // 地址
+        int port;                             // 端口
+        std::deque<TcpConnectionPtr> idle;    // 空闲连接
+        std::deque<acquire_callback> waiters; // 等待连接的请求
+        size_t connections;                   // 已建立的连接数
+        size_t connecting;                    // 正在建立的连接数
+    };
+
+    // 池中的连接及其所属的上游地址
+    struct PooledConnection
+    {
+        TcpConnectionPtr conn;
+        Upstream *upstream;
+    };
+
+    Upstream *find_upstream(const std::string &ip, int port)
+    {
+        std::unique_ptr<Upstream> &upstream = upstreams_[ip + ":" + std::to_string(port)];
+        if (!upstream)
+            upstream.reset(new Upstream(ip, port));
+        return upstream.get();
+    }
+
+    // 发起一个到上游地址的连接
+    void connect(Upstream *upstream)
+    {
+        std::shared_ptr<Connector> connector = std::make_shared<Connector>(loop_, upstream->ip, upstream->port);
+        connector->set_retry_delay(init_retry_ms_, max_retry_ms_);
+        connector->set_max_retries(max_retries_);
+        connector->set_connect_timeout(connect_timeout_ms_);
+
+        Connector *key = connector.get();
+        connector->set_new_connection_callback([this, upstream, key](int fd)
+                                               {
+            finish_connect(upstream, key);
+            new_connection(upstream, fd); });
+        connector->set_error_callback([this, upstream, key](int err)
+                                      {
+            finish_connect(upstream, key);
+            connect_failed(upstream, err); });
+
+        upstream->connecting++;
+        connectors_[key] = connector;
+        connector->start();
+    }
+
+    // 连接器完成使命 正在执行其回调 延迟到任务队列中释放
+    void finish_connect(Upstream *upstream, Connector *key)
+    {
+        upstream->connecting--;
+        auto it = connectors_.find(key);
+        if (it == connectors_.end())
+            return;
+
+        std::shared_ptr<Connector> connector = it->second;
+        connectors_.erase(it);
+        loop_->queue_in_loop([connector]() {});
+    }
+
+    // 连接建立 创建连接对象并交给等待的请求
+    void new_connection(Upstream *upstream, int fd)
+    {
+        uint64_t id = next_conn_id_++;
+        TcpConnectionPtr conn = std::make_shared<TcpConnection>(loop_, fd, id);
+        if (no_delay_)
+            conn->set_tcp_no_delay(true);
+        conn->set_connection_callback(connection_callback_);
+        conn->set_message_callback(message_callback_);
+        conn->set_write_complete_callback(write_complete_callback_);
+        conn->set_close_callback(std::bind(&TcpClient::remove_connection, this, std::placeholders::_1));
+
+        connections_[id] = PooledConnection{conn, upstream};
+        upstream->connections++;
+        conn->connect_established();
+        if (conn->connected()) // 连接回调中可能已关闭连接
+            hand_out(upstream, conn);
+    }
+
+    // 放弃连接 以失败回调一个多出的等待请求 其余请求仍等待正在建立或将被归还的连接
+    // 既没有已建立的连接也没有正在建立的连接时 等待的请求不会再得到连接 全部以失败回调
+    void connect_failed(Upstream *upstream, int err)
+    {
+        LOG_FMT(ERROR, "connect to {}:{} failed! errno={}", upstream->ip, upstream->port, err);
+        if (upstream->connections + upstream->connecting == 0)
+        {
+            std::deque<acquire_callback> waiters;
+            waiters.swap(upstream->waiters); // 回调中可能再次acquire
+            for (acquire_callback &cb : waiters)
+                cb(TcpConnectionPtr());
+            return;
+        }
+        if (upstream->waiters.empty() || upstream->waiters.size() <= upstream->connecting)
+            return;
+
+        acquire_callback cb = std::move(upstream->waiters.front());
+        upstream->waiters.pop_front();
+        cb(TcpConnectionPtr());
+    }
+
+    // 将可用的连接交给最早等待的请求 没有请求时放入空闲列表
+    void hand_out(Upstream *upstream, const TcpConnectionPtr &conn)
+    {
+        if (!upstream->waiters.empty())
+        {
+            acquire_callback cb = std::move(upstream->waiters.front());
+            upstream->waiters.pop_front();
+            cb(conn);
+            return;
+        }
+
+        if (upstream->idle.size() >= max_idle_)
+        {
+            conn->shutdown(); // 空闲连接过多 关闭多余的连接
+            return;
+        }
+        upstream->idle.push_back(conn);
+    }
+
+    // 连接关闭后移出连接池 名额空出后为等待的请求补充连接
+    // connect_destroyed放入任务队列 保证连接在handle_close返回后才释放
+    void remove_connection(const TcpConnectionPtr &conn)
+    {
+        auto it = connections_.find(conn->id());
+        if (it == connections_.end())
+            return;
+
+        Upstream *upstream = it->second.upstream;
+        connections_.erase(it);
+        upstream->connections--;
+        for (auto idle = upstream->idle.begin(); idle != upstream->idle.end(); ++idle)
+        {
+            if (*idle == conn)
+            {
+                upstream->idle.erase(idle);
+                break;
+            }
+        }
+        loop_->queue_in_loop([conn]()
+                             { conn->connect_destroyed(); });
+
+        if (upstream->waiters.size() > upstream->connecting && upstream->connections + upstream->connecting < max_connections_)
+            connect(upstream);
+    }
+
+private:
+    EventLoop *loop_;                                                        // 所属事件循环
+    uint64_t next_conn_id_;                                                  // 下一个连接id
+    size_t max_connections_;                                                 // 每个上游地址的最大连接数
+    size_t max_idle_;                                                        // 每个上游地址保留的最大空闲连接数
+    int max_retries_;                                                        // 建立连接时的最大重试次数
+    uint64_t init_retry_ms_;                                                 // 首次重试的退避时间(毫秒)
+    uint64_t max_retry_ms_;                                                  // 最大退避时间(毫秒)
+    uint64_t connect_timeout_ms_;                                            // 单次连接超时(毫秒)
+    bool no_delay_;                                                          // 是否开启TCP_NODELAY
+    std::unordered_map<std::string, std::unique_ptr<Upstream>> upstreams_;   // 上游地址 键为ip:port
+    std::unordered_map<uint64_t, PooledConnection> connections_;             // 所有存活的连接
+    std::unordered_map<Connector *, std::shared_ptr<Connector>> connectors_; // 正在建立的连接
+    connection_callback connection_callback_;                                // 连接建立或断开回调
+    message_callback message_callback_;                                      // 收到数据回调
+    write_complete_callback write_complete_callback_;                        // 发送完毕回调
+};
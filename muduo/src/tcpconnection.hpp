@@ -0,0 +1,524 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <atomic>
+#include <functional>
+#include <cerrno>
+#include <sys/socket.h>
+#include "sock.hpp"
+#include "channel.hpp"
+#include "buffer.hpp"
+#include "chainbuffer.hpp"
+#include "eventloop.hpp"
+#include "log.hpp"
+
+static const size_t CONNECTION_HIGH_WATER_MARK = 64 * 1024 * 1024; // 默认输出缓冲区高水位
+
+class TcpConnection;
+using TcpConnectionPtr = std::shared_ptr<TcpConnection>;
+
+using connection_callback = std::function<void(const TcpConnectionPtr &)>;              // 连接建立或断开回调 通过connected()区分
+using message_callback = std::function<void(const TcpConnectionPtr &, Buffer *)>;       // 收到数据回调 数据位于输入缓冲区中
+using write_complete_callback = std::function<void(const TcpConnectionPtr &)>;          // 输出缓冲区发送完毕回调
+using high_water_mark_callback = std::function<void(const TcpConnectionPtr &, size_t)>; // 越过高水位回调 参数为待发送字节数
+using close_callback = std::function<void(const TcpConnectionPtr &)>;                   // 连接关闭回调 供TcpServer移除连接
+using activity_callback = std::function<void()>;                                        // 套接字读写活动回调 供TcpServer刷新空闲定时器
+
+// 连接状态
+enum class ConnState
+{
+    CONNECTING,    // 正在建立连接
+    CONNECTED,     // 已建立连接
+    DISCONNECTING, // 正在断开连接 等待输出缓冲区发送完毕
+    DISCONNECTED,  // 已断开连接
+};
+
+// TCP连接 绑定套接字 Channel 输入缓冲区和输出缓冲区 所有IO都在所属事件循环线程中进行
+// 发送时先尝试直接写入 写不完的部分放入输出缓冲区 仅在有待发送数据时监控可写事件
+// 待发送数据越过高水位时回调通知 生产者据此暂停发送 发送完毕后回调write_complete后再继续
+// 由shared_ptr管理 最后一个引用应在所属事件循环线程中释放 输入缓冲区的内存归还给该线程的内存池
+class TcpConnection : public std::enable_shared_from_this<TcpConnection>, private ChannelHandler
+{
+public:
+    TcpConnection(EventLoop *loop, int fd, uint64_t id)
+        : loop_(loop), id_(id), state_(ConnState::CONNECTING), peer_closed_(false), message_callback_replaced_(false), idle_timer_(0), socket_(fd),
+          channel_(loop, fd), input_(BUFFER_DEAULT_SIZE, loop->buffer_pool()), high_water_mark_(CONNECTION_HIGH_WATER_MARK)
+    {
+        channel_.set_handler(this);
+    }
+
+    ~TcpConnection()
+    {
+        if (state_ != ConnState::DISCONNECTED)
+            LOG_FMT(WARN, "connection {} destroyed before disconnected", id_);
+    }
+
+    TcpConnection(const TcpConnection &) = delete;
+    TcpConnection &operator=(const TcpConnection &) = delete;
+
+    EventLoop *owner_loop() const { return loop_; }                         // 所属事件循环
+    uint64_t id() const { return id_; }                                     // 连接id
+    int fd() const { return socket_.GetFd(); }                              // 套接字描述符
+    ConnState state() const { return state_; }                              // 连接状态
+    bool connected() const { return state_ == ConnState::CONNECTED; }       // 是否已连接
+    bool disconnected() const { return state_ == ConnState::DISCONNECTED; } // 是否已断开
+    Buffer *input_buffer() { return &input_; }                              // 输入缓冲区 只能在所属线程中使用
+    ChainBuffer *output_buffer() { return &output_; }                       // 输出缓冲区 只能在所属线程中使用
+
+    void set_connection_callback(const connection_callback &cb) { connection_callback_ = cb; }
+    void set_message_callback(const message_callback &cb)
+    {
+        message_callback_ = cb;
+        message_callback_replaced_ = true;
+    }
+    void set_write_complete_callback(const write_complete_callback &cb) { write_complete_callback_ = cb; }
+    void set_close_callback(const close_callback &cb) { close_callback_ = cb; }
+    void set_activity_callback(const activity_callback &cb) { activity_callback_ = cb; }
+
+    // 空闲定时器id 由TcpServer在所属线程中设置和读取
+    void set_idle_timer(uint64_t id) { idle_timer_ = id; }
+    uint64_t idle_timer() const { return idle_timer_; }
+
+    // 设置高水位回调 待发送数据从低于mark增长到不低于mark时回调一次
+    void set_high_water_mark_callback(const high_water_mark_callback &cb, size_t mark)
+    {
+        high_water_mark_callback_ = cb;
+        high_water_mark_ = mark;
+    }
+
+    // 设置TCP_NODELAY 请求应答式的交互应开启 避免Nagle算法与延迟确认叠加造成的延迟
+    void set_tcp_no_delay(bool on) { socket_.NoDelay(on); }
+
+    // 开启MSG_ZEROCOPY发送 不小于CHAIN_ZEROCOPY_THRESHOLD的数据由内核直接引用数据块 只能在所属线程中调用
+    // 以send(const ChainBuffer &)发送共享的数据块时用户态和内核都不拷贝 内核不支持时返回false
+    bool enable_zerocopy()
+    {
+        loop_->assert_in_loop();
+        return output_.enable_zerocopy(socket_.GetFd());
+    }
+    bool zerocopy_enabled() const { return output_.zerocopy_enabled(); }
+
+    // 发送数据 可在任意线程调用 其他线程调用时拷贝数据后转交所属线程
+    void send(const char *data, size_t len)
+    {
+        if (state_ != ConnState::CONNECTED)
+            return;
+
+        if (loop_->is_in_loop_thread())
+        {
+            send_in_loop(data, len);
+            return;
+        }
+
+        std::shared_ptr<TcpConnection> self(shared_from_this());
+        std::string copy(data, len);
+        loop_->queue_in_loop([self, copy]()
+                             { self->send_in_loop(copy.data(), copy.size()); });
+    }
+
+    void send(const std::string &data) { send(data.data(), data.size()); }
+
+    // 发送缓冲区中的全部可读数据 可在任意线程调用
+    void send(Buffer *buffer)
+    {
+        send(buffer->begin_read(), buffer->readable_size());
+        buffer->move_read_off(buffer->readable_size());
+    }
+
+    // 发送chain中的全部数据 不拷贝数据 只增加数据块的引用计数 同一份数据可发给多个连接 可在任意线程调用
+    // 数据块此后不能再修改 见ChainBuffer
+    void send(const ChainBuffer &chain)
+    {
+        if (state_ != ConnState::CONNECTED)
+            return;
+
+        if (loop_->is_in_loop_thread())
+        {
+            send_chain_in_loop(chain);
+            return;
+        }
+
+        std::shared_ptr<TcpConnection> self(shared_from_this());
+        std::shared_ptr<ChainBuffer> shared = std::make_shared<ChainBuffer>();
+        shared->append_chain(chain);
+        loop_->queue_in_loop([self, shared]()
+                             { self->send_chain_in_loop(*shared); });
+    }
+
+    // 发送数据块中offset开始的len字节 不拷贝数据 可在任意线程调用
+    void send(const BlockRef &block, size_t offset, size_t len)
+    {
+        ChainBuffer chain;
+        chain.append_slice(block, offset, len);
+        send(chain);
+    }
+
+    // 零拷贝发送文件fd中从offset开始的len字节 与send的数据保持顺序 只能在所属线程中调用
+    // 内部复制描述符 调用者可以立即关闭fd
+    void send_file(int fd, off_t offset, size_t len)
+    {
+        loop_->assert_in_loop();
+        if (state_ != ConnState::CONNECTED)
+            return;
+
+        if (!output_.append_file(fd, offset, len))
+            return;
+        check_high_water_mark(output_.readable_size() - len, output_.readable_size());
+        if (!sending())
+            handle_write(); // 之前没有待发送数据 立即尝试发送
+    }
+
+    // 关闭写端 输出缓冲区中的数据发送完毕后执行 此后仍可接收对端数据 可在任意线程调用
+    void shutdown()
+    {
+        ConnState expected = ConnState::CONNECTED;
+        if (!state_.compare_exchange_strong(expected, ConnState::DISCONNECTING))
+            return;
+
+        std::shared_ptr<TcpConnection> self(shared_from_this());
+        loop_->run_in_loop([self]()
+                           { self->shutdown_in_loop(); });
+    }
+
+    // 立即关闭连接 丢弃未发送的数据 可在任意线程调用
+    void force_close()
+    {
+        ConnState state = state_;
+        if (state != ConnState::CONNECTED && state != ConnState::DISCONNECTING)
+            return;
+        state_ = ConnState::DISCONNECTING;
+
+        std::shared_ptr<TcpConnection> self(shared_from_this());
+        loop_->queue_in_loop([self]()
+                             { self->force_close_in_loop(); });
+    }
+
+    // 连接建立 开始监控读事件 由TcpServer在所属线程中调用
+    void connect_established()
+    {
+        loop_->assert_in_loop();
+        state_ = ConnState::CONNECTED;
+        metric_add(loop_->metrics().connections, 1);
+        channel_.enable_read();
+        if (connection_callback_)
+            connection_callback_(shared_from_this());
+    }
+
+    // 连接销毁 移除监控 由TcpServer在所属线程中调用 连接已通过handle_close关闭时只移除监控
+    void connect_destroyed()
+    {
+        loop_->assert_in_loop();
+        if (state_ == ConnState::CONNECTED || state_ == ConnState::DISCONNECTING)
+        {
+            state_ = ConnState::DISCONNECTED;
+            metric_sub(loop_->metrics().connections, 1);
+            channel_.disable_all();
+            if (connection_callback_)
+                connection_callback_(shared_from_this());
+        }
+        unwatch_source();
+        channel_.remove();
+    }
+
+private:
+    // 在所属线程中发送数据 输出缓冲区为空时先直接写入套接字
+    void send_in_loop(const char *data, size_t len)
+    {
+        loop_->assert_in_loop();
+        if (state_ == ConnState::DISCONNECTED)
+        {
+            LOG_MSG(WARN, "connection disconnected, give up sending");
+            return;
+        }
+
+        // 开启零拷贝时较大的数据不直接拷贝进内核 放入输出缓冲区后以MSG_ZEROCOPY发送
+        bool zerocopy = output_.zerocopy_enabled() && len >= CHAIN_ZEROCOPY_THRESHOLD;
+        ssize_t written = 0;
+        size_t remaining = len;
+        if (!zerocopy && !channel_.write_enabled() && output_.empty())
+        {
+            written = ::send(socket_.GetFd(), data, len, MSG_NOSIGNAL);
+            if (written >= 0)
+            {
+                metric_add(loop_->metrics().bytes_out, written);
+                remaining = len - written;
+                if (remaining == 0)
+                    queue_write_complete();
+            }
+            else
+            {
+                written = 0;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                {
+                    LOG_FMT(ERROR, "connection {} send failed! errno={}", id_, errno);
+                    if (errno == EPIPE || errno == ECONNRESET)
+                        return; // 对端已关闭 不再缓存数据 读事件会处理关闭
+                }
+            }
+        }
+
+        if (remaining == 0)
+            return;
+
+        size_t old_len = output_.readable_size();
+        output_.write(data + written, remaining);
+        check_high_water_mark(old_len, output_.readable_size());
+        if (sending())
+            return;
+        if (zerocopy)
+            handle_write(); // 之前没有待发送数据 立即发送
+        else
+            channel_.enable_write();
+    }
+
+    // 在所属线程中追加共享的数据块 之前没有待发送数据时立即发送
+    void send_chain_in_loop(const ChainBuffer &chain)
+    {
+        loop_->assert_in_loop();
+        if (state_ == ConnState::DISCONNECTED)
+        {
+            LOG_MSG(WARN, "connection disconnected, give up sending");
+            return;
+        }
+
+        size_t old_len = output_.readable_size();
+        output_.append_chain(chain);
+        check_high_water_mark(old_len, output_.readable_size());
+        if (!sending())
+            handle_write();
+    }
+
+    // 待发送数据越过高水位时回调
+    void check_high_water_mark(size_t old_len, size_t new_len)
+    {
+        if (high_water_mark_callback_ && old_len < high_water_mark_ && new_len >= high_water_mark_)
+        {
+            std::shared_ptr<TcpConnection> self(shared_from_this());
+            loop_->queue_in_loop([self, new_len]()
+                                 { self->high_water_mark_callback_(self, new_len); });
+        }
+    }
+
+    // 发送完毕回调放入任务队列 避免在回调中继续send造成递归
+    void queue_write_complete()
+    {
+        if (!write_complete_callback_)
+            return;
+
+        std::shared_ptr<TcpConnection> self(shared_from_this());
+        loop_->queue_in_loop([self]()
+                             { self->write_complete_callback_(self); });
+    }
+
+    // 输出缓冲区为空时关闭写端 否则等待发送完毕后由handle_write关闭
+    void shutdown_in_loop()
+    {
+        loop_->assert_in_loop();
+        if (!sending() && ::shutdown(socket_.GetFd(), SHUT_WR) == -1)
+            LOG_FMT(ERROR, "connection {} shutdown failed! errno={}", id_, errno);
+    }
+
+    void force_close_in_loop()
+    {
+        loop_->assert_in_loop();
+        if (state_ == ConnState::CONNECTED || state_ == ConnState::DISCONNECTING)
+            handle_close();
+    }
+
+    // 读事件 数据读入输入缓冲区后回调 对端关闭写端时若仍有待发送数据则发送完毕后再关闭
+    void handle_read() override
+    {
+        int saved_errno = 0;
+        ssize_t n = input_.read_from_fd(socket_.GetFd(), &saved_errno);
+        if (n > 0)
+        {
+            metric_add(loop_->metrics().bytes_in, n);
+            if (!message_callback_)
+            {
+                input_.move_read_off(input_.readable_size());
+                return;
+            }
+
+            // 回调中可能替换消息回调 如连接池中归还后立即被下一个请求取得
+            // 先移出再调用 避免正在执行的回调被销毁 未被替换时再移回
+            message_callback cb = std::move(message_callback_);
+            message_callback_replaced_ = false;
+            cb(shared_from_this(), &input_);
+            if (!message_callback_replaced_)
+                message_callback_ = std::move(cb);
+            return;
+        }
+
+        if (n == 0)
+        {
+            if (output_.empty())
+            {
+                handle_close();
+                return;
+            }
+
+            // 对端半关闭 停止读取 待发送数据发送完毕后关闭连接
+            peer_closed_ = true;
+            state_ = ConnState::DISCONNECTING;
+            channel_.disable_read();
+            return;
+        }
+
+        if (saved_errno != EAGAIN && saved_errno != EINTR)
+        {
+            LOG_FMT(ERROR, "connection {} read failed! errno={}", id_, saved_errno);
+            handle_close();
+        }
+    }
+
+    // 写事件 发送输出缓冲区中的数据 发送完毕后停止监控可写事件
+    void handle_write() override
+    {
+        if (state_ == ConnState::DISCONNECTED)
+            return; // 同一次事件中读事件已关闭连接
+        if (output_.zerocopy_pending() > 0)
+            output_.reap_zerocopy(socket_.GetFd());
+
+        int saved_errno = 0;
+        while (!output_.empty())
+        {
+            ssize_t n = output_.write_to_fd(socket_.GetFd(), &saved_errno);
+            if (n >= 0)
+            {
+                metric_add(loop_->metrics().bytes_out, n);
+                continue;
+            }
+
+            if (saved_errno == EAGAIN || saved_errno == EWOULDBLOCK)
+            {
+                int source_fd = output_.starved_source_fd();
+                if (source_fd != -1)
+                {
+                    // 文件数据段的来源暂无数据 套接字仍然可写 监控可写事件会持续空转 改为等待来源可读
+                    if (channel_.write_enabled())
+                        channel_.disable_write();
+                    watch_source(source_fd);
+                    return;
+                }
+                if (!channel_.write_enabled())
+                    channel_.enable_write();
+                return;
+            }
+
+            LOG_FMT(ERROR, "connection {} write failed! errno={}", id_, saved_errno);
+            handle_close();
+            return;
+        }
+
+        if (channel_.write_enabled())
+            channel_.disable_write();
+        queue_write_complete();
+
+        if (state_ == ConnState::DISCONNECTING)
+        {
+            if (peer_closed_)
+                handle_close(); // 对端已关闭写端 数据发送完毕后关闭连接
+            else
+                shutdown_in_loop();
+        }
+    }
+
+    // 是否有待发送数据在等待发送 等待套接字可写或等待文件数据段的来源可读
+    bool sending() const { return channel_.write_enabled() || source_channel_; }
+
+    // 监控文件数据段的来源描述符 来源可读或关闭后移除监控并继续发送
+    void watch_source(int fd)
+    {
+        if (source_channel_)
+            return;
+
+        source_channel_.reset(new CallbackChannel(loop_, fd));
+        event_callback ready = [this]()
+        {
+            if (!source_channel_)
+                return; // 同一次事件中读和关闭回调都可能被调用
+            std::shared_ptr<TcpConnection> self(shared_from_this());
+            unwatch_source();
+            handle_write();
+        };
+        source_channel_->set_read_callback(ready);
+        source_channel_->set_close_callback(ready);
+        source_channel_->set_error_callback(ready);
+        source_channel_->enable_read();
+    }
+
+    // 停止监控来源描述符 可能正在处理该Channel的事件 延迟到任务队列中释放
+    void unwatch_source()
+    {
+        if (!source_channel_)
+            return;
+
+        source_channel_->disable_all();
+        source_channel_->remove();
+        std::shared_ptr<CallbackChannel> channel(source_channel_.release());
+        loop_->queue_in_loop([channel]() {});
+    }
+
+    // 错误事件 处理零拷贝完成通知 套接字出错时关闭连接
+    void handle_error() override
+    {
+        if (output_.zerocopy_pending() > 0)
+            output_.reap_zerocopy(socket_.GetFd());
+
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(socket_.GetFd(), SOL_SOCKET, SO_ERROR, &err, &len) == -1)
+            err = errno;
+        if (err == 0)
+            return; // 仅为错误队列中的零拷贝通知
+
+        LOG_FMT(ERROR, "connection {} socket error! errno={}", id_, err);
+        handle_close();
+    }
+
+    // 读写事件发生后回调一次 表示连接仍然活跃
+    void handle_any_event() override
+    {
+        if (activity_callback_)
+            activity_callback_();
+    }
+
+    // 关闭事件 停止监控并通知使用者和TcpServer
+    void handle_close() override
+    {
+        if (state_ == ConnState::DISCONNECTED)
+            return;
+
+        state_ = ConnState::DISCONNECTED;
+        metric_sub(loop_->metrics().connections, 1);
+        channel_.disable_all();
+        unwatch_source();
+
+        std::shared_ptr<TcpConnection> self(shared_from_this()); // 回调中可能释放其他引用
+        if (connection_callback_)
+            connection_callback_(self);
+        if (close_callback_)
+            close_callback_(self);
+    }
+
+private:
+    EventLoop *loop_;                                   // 所属事件循环
+    uint64_t id_;                                       // 连接id
+    std::atomic<ConnState> state_;                      // 连接状态
+    bool peer_closed_;                                  // 对端是否已关闭写端
+    bool message_callback_replaced_;                    // 消息回调执行期间是否被替换
+    uint64_t idle_timer_;                               // 空闲定时器id
+    Socket socket_;                                     // 连接套接字 析构时关闭
+    Channel channel_;                                   // 套接字对应的Channel
+    std::unique_ptr<CallbackChannel> source_channel_;   // 等待文件数据段的来源可读时对应的Channel
+    Buffer input_;                                      // 输入缓冲区
+    ChainBuffer output_;                                // 输出缓冲区
+    size_t high_water_mark_;                            // 输出缓冲区高水位
+    connection_callback connection_callback_;           // 连接建立或断开回调
+    message_callback message_callback_;                 // 收到数据回调
+    write_complete_callback write_complete_callback_;   // 发送完毕回调
+    high_water_mark_callback high_water_mark_callback_; // 高水位回调
+    close_callback close_callback_;                     // 连接关闭回调
+    activity_callback activity_callback_;               // 读写活动回调
+};
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <unordered_map>
+#include "eventloop.hpp"
+#include "loopthread.hpp"
+#include "acceptor.hpp"
+#include "tcpconnection.hpp"
+#include "timerwheel.hpp"
+#include "log.hpp"
+
+static const uint64_t SERVER_IDLE_TICK_MS = 1000; // 空闲检测时间轮默认刻度(毫秒)
+
+// 监听模式
+enum class AcceptMode
+{
+    MAIN_ACCEPTOR, // 主事件循环监听 将新连接分发给从事件循环
+    REUSE_PORT,    // 每个事件循环各自监听同一端口 由内核按SO_REUSEPORT分发新连接
+    EXCLUSIVE,     // 所有事件循环共享同一个监听套接字 以EPOLLEXCLUSIVE监控 每个新连接只唤醒一个事件循环
+};
+
+// 主事件循环监听时新连接的分发策略
+enum class DispatchPolicy
+{
+    ROUND_ROBIN,  // 轮询
+    LEAST_LOADED, // 负载最小
+};
+
+class TcpServer
+{
+public:
+    TcpServer(EventLoop *base_loop, int port, AcceptMode mode = AcceptMode::MAIN_ACCEPTOR, const std::string &ip = "0.0.0.0")
+        : base_loop_(base_loop), port_(port), ip_(ip), mode_(mode), policy_(DispatchPolicy::ROUND_ROBIN),
+          started_(false), pool_(base_loop), next_conn_id_(1), high_water_mark_(CONNECTION_HIGH_WATER_MARK),
+          idle_timeout_ms_(0), idle_tick_ms_(SERVER_IDLE_TICK_MS) {}
+
+    // 析构函数 监听器和连接需在各自的事件循环线程中销毁
+    ~TcpServer()
+    {
+        base_loop_->assert_in_loop();
+        for (std::unique_ptr<Acceptor> &acceptor : acceptors_)
+        {
+            EventLoop *loop = acceptor->owner_loop();
+            if (loop->is_in_loop_thread())
+            {
+                acceptor.reset();
+                continue;
+            }
+
+            std::promise<void> done;
+            loop->run_in_loop([&]()
+                              { acceptor.reset(); done.set_value(); });
+            done.get_future().wait();
+        }
+
+        // 监听器销毁前转交的新连接可能仍在各事件循环的任务队列中 等待其执行完毕后再收集连接
+        for (EventLoop *loop : pool_.all_loops())
+        {
+            if (loop->is_in_loop_thread())
+                continue;
+            std::promise<void> done;
+            loop->queue_in_loop([&]()
+                                { done.set_value(); });
+            done.get_future().wait();
+        }
+
+        // 按事件循环分组剩余连接 每个事件循环一次性停止空闲检测并销毁其上的连接
+        std::unordered_map<EventLoop *, std::vector<TcpConnectionPtr>> by_loop;
+        {
+            std::lock_guard<std::mutex> lock(conn_mutex_);
+            for (auto &kv : connections_)
+                by_loop[kv.second->owner_loop()].push_back(kv.second);
+            for (auto &kv : idle_wheels_)
+                by_loop[kv.first];
+            connections_.clear();
+        }
+        for (auto &kv : by_loop)
+        {
+            EventLoop *loop = kv.first;
+            std::vector<TcpConnectionPtr> &conns = kv.second;
+            auto destroy = [&]()
+            {
+                {
+                    std::lock_guard<std::mutex> lock(conn_mutex_);
+                    auto it = idle_wheels_.find(loop);
+                    if (it != idle_wheels_.end())
+                        loop->cancel(it->second->tick_timer);
+                }
+                for (const TcpConnectionPtr &conn : conns)
+                    conn->connect_destroyed();
+                conns.clear(); // 最后一个引用在所属线程中释放
+            };
+            if (loop->is_in_loop_thread())
+            {
+                destroy();
+                continue;
+            }
+
+            std::promise<void> done;
+            loop->run_in_loop([&]()
+                              { destroy(); done.set_value(); });
+            done.get_future().wait();
+        }
+    }
+
+    TcpServer(const TcpServer &) = delete;
+    TcpServer &operator=(const TcpServer &) = delete;
+
+    // 设置处理连接的线程数量 必须在start之前调用
+    void set_thread_count(int count) { pool_.set_thread_count(count); }
+
+    // 设置新连接分发策略 仅对MAIN_ACCEPTOR模式生效
+    void set_dispatch_policy(DispatchPolicy policy) { policy_ = policy; }
+
+    // 以下回调必须在start之前设置 在连接所属的事件循环线程中执行
+    void set_connection_callback(const connection_callback &cb) { connection_callback_ = cb; }             // 连接建立或断开
+    void set_message_callback(const message_callback &cb) { message_callback_ = cb; }                      // 收到数据
+    void set_write_complete_callback(const write_complete_callback &cb) { write_complete_callback_ = cb; } // 输出缓冲区发送完毕
+
+    // 设置高水位回调 每个连接待发送数据越过mark时回调
+    void set_high_water_mark_callback(const high_water_mark_callback &cb, size_t mark)
+    {
+        high_water_mark_callback_ = cb;
+        high_water_mark_ = mark;
+    }
+
+    // 开启空闲连接回收 超过timeout_ms没有读写活动的连接被关闭 必须在start之前调用
+    // 每个事件循环使用一个时间轮 每tick_ms推进一次 回收时间的误差不超过一个刻度
+    void set_idle_timeout(uint64_t timeout_ms, uint64_t tick_ms = SERVER_IDLE_TICK_MS)
+    {
+        idle_timeout_ms_ = timeout_ms;
+        idle_tick_ms_ = tick_ms > 0 ? tick_ms : 1;
+    }
+
+    // 当前连接数
+    size_t connection_count()
+    {
+        std::lock_guard<std::mutex> lock(conn_mutex_);
+        return connections_.size();
+    }
+
+    // 启动服务器 必须在主事件循环线程中调用
+    void start()
+    {
+        base_loop_->assert_in_loop();
+        if (started_)
+            return;
+        started_ = true;
+
+        if (mode_ == AcceptMode::REUSE_PORT)
+        {
+            // 每个事件循环在自己的线程中创建监听套接字 新连接直接在本线程处理 无需跨线程转交
+            pool_.start(std::bind(&TcpServer::start_sharded_acceptor, this, std::placeholders::_1));
+            return;
+        }
+
+        if (mode_ == AcceptMode::EXCLUSIVE)
+        {
+            // 主事件循环只创建监听套接字 不监听 各事件循环复制该套接字后独占唤醒地监听
+            acceptors_.emplace_back(new Acceptor(base_loop_, port_, false, ip_));
+            pool_.start(std::bind(&TcpServer::start_shared_acceptor, this, std::placeholders::_1));
+            return;
+        }
+
+        pool_.start();
+        acceptors_.emplace_back(new Acceptor(base_loop_, port_, false, ip_));
+        acceptors_.back()->set_accept_callback(std::bind(&TcpServer::dispatch_connection, this, std::placeholders::_1));
+        acceptors_.back()->listen();
+        LOG_FMT(INFO, "tcp server listening on port {}", port_);
+    }
+
+    // 获取所有处理连接的事件循环
+    std::vector<EventLoop *> all_loops() const { return pool_.all_loops(); }
+
+    AcceptMode accept_mode() const { return mode_; }
+
+private:
+    // 主事件循环监听模式 按分发策略选择事件循环并将新连接转交过去
+    void dispatch_connection(int fd)
+    {
+        EventLoop *loop = policy_ == DispatchPolicy::LEAST_LOADED ? pool_.least_loaded_loop() : pool_.next_loop();
+        loop->run_in_loop([this, loop, fd]()
+                          { new_connection(loop, fd); });
+    }
+
+    // 端口复用模式 在每个事件循环线程中创建并启动监听
+    void start_sharded_acceptor(EventLoop *loop)
+    {
+        Acceptor *acceptor = new Acceptor(loop, port_, true, ip_);
+        acceptor->set_accept_callback([this, loop](int fd)
+                                      { new_connection(loop, fd); });
+        acceptor->listen();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        acceptors_.emplace_back(acceptor);
+        LOG_FMT(INFO, "tcp server sharded listening on port {}", port_);
+    }
+
+    // 共享监听模式 在每个事件循环线程中复制监听套接字并启动监听
+    void start_shared_acceptor(EventLoop *loop)
+    {
+        Acceptor *acceptor = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            acceptor = new Acceptor(loop, *acceptors_.front());
+            acceptors_.emplace_back(acceptor);
+        }
+        acceptor->set_accept_callback([this, loop](int fd)
+                                      { new_connection(loop, fd); });
+        acceptor->listen();
+        LOG_FMT(INFO, "tcp server exclusive listening on port {}", port_);
+    }
+
+    // 在负责该连接的事件循环中创建连接对象
+    void new_connection(EventLoop *loop, int fd)
+    {
+        uint64_t id = next_conn_id_.fetch_add(1, std::memory_order_relaxed);
+        TcpConnectionPtr conn = std::make_shared<TcpConnection>(loop, fd, id);
+        conn->set_connection_callback(connection_callback_);
+        conn->set_message_callback(message_callback_);
+        conn->set_write_complete_callback(write_complete_callback_);
+        if (high_water_mark_callback_)
+            conn->set_high_water_mark_callback(high_water_mark_callback_, high_water_mark_);
+        conn->set_close_callback(std::bind(&TcpServer::remove_connection, this, std::placeholders::_1));
+
+        {
+            std::lock_guard<std::mutex> lock(conn_mutex_);
+            connections_[id] = conn;
+        }
+        if (idle_timeout_ms_ > 0)
+            watch_idle(loop, conn);
+        conn->connect_established();
+    }
+
+    // 获取事件循环的空闲检测时间轮 首次使用时创建 并由run_every定期推进 在该事件循环线程中调用
+    TimerWheel *idle_wheel(EventLoop *loop)
+    {
+        std::lock_guard<std::mutex> lock(conn_mutex_);
+        std::unique_ptr<IdleWheel> &entry = idle_wheels_[loop];
+        if (!entry)
+        {
+            entry.reset(new IdleWheel(idle_tick_ms_, timer_now() / 1000));
+            TimerWheel *wheel = &entry->wheel;
+            entry->tick_timer = loop->run_every(idle_tick_ms_ * 1000, [wheel]()
+                                                { wheel->advance(timer_now() / 1000); });
+        }
+        return &entry->wheel;
+    }
+
+    // 为连接注册空闲定时器 读写活动时O(1)刷新 到期时关闭连接
+    // 到期任务只持有弱引用 并通过force_close转入任务队列关闭 即使连接正处于回调中也是安全的
+    void watch_idle(EventLoop *loop, const TcpConnectionPtr &conn)
+    {
+        TimerWheel *wheel = idle_wheel(loop);
+        std::weak_ptr<TcpConnection> weak(conn);
+        uint64_t timer = wheel->timer_add(idle_timeout_ms_, [weak]()
+                                          {
+            TcpConnectionPtr conn = weak.lock();
+            if (!conn)
+                return;
+            LOG_FMT(INFO, "connection {} idle timeout", conn->id());
+            conn->force_close(); });
+        conn->set_idle_timer(timer);
+        conn->set_activity_callback([wheel, timer]()
+                                    { wheel->refresh_timer(timer); });
+    }
+
+    // 连接关闭后从连接表中移除 在连接所属线程中执行
+    // connect_destroyed放入任务队列 保证连接在handle_close返回后才释放
+    void remove_connection(const TcpConnectionPtr &conn)
+    {
+        {
+            std::lock_guard<std::mutex> lock(conn_mutex_);
+            connections_.erase(conn->id());
+        }
+        if (idle_timeout_ms_ > 0)
+            idle_wheel(conn->owner_loop())->cancel_timer(conn->idle_timer()); // 定时器已到期时无效果
+        conn->owner_loop()->queue_in_loop([conn]()
+                                          { conn->connect_destroyed(); });
+    }
+
+private:
+    // 每个事件循环的空闲检测时间轮
+    struct IdleWheel
+    {
+        IdleWheel(uint64_t tick_ms, uint64_t now_ms) : wheel(tick_ms, now_ms), tick_timer(0) {}
+
+        TimerWheel wheel;   // 时间轮 只在所属事件循环线程中使用
+        TimerId tick_timer; // 推进时间轮的重复定时器
+    };
+
+private:
+    EventLoop *base_loop_;                                                    // 主事件循环
+    int port_;                                                                // 监听端口
+    std::string ip_;                                                          // 监听地址
+    AcceptMode mode_;                                                         // 监听模式
+    DispatchPolicy policy_;                                                   // 新连接分发策略
+    bool started_;                                                            // 是否已启动
+    EventLoopThreadPool pool_;                                                // 事件循环线程池
+    std::mutex mutex_;                                                        // 保护acceptors_
+    std::vector<std::unique_ptr<Acceptor>> acceptors_;                        // 监听器
+    std::atomic<uint64_t> next_conn_id_;                                      // 下一个连接id
+    std::mutex conn_mutex_;                                                   // 保护connections_和idle_wheels_
+    std::unordered_map<uint64_t, TcpConnectionPtr> connections_;              // 所有存活的连接
+    connection_callback connection_callback_;                                 // 连接建立或断开回调
+    message_callback message_callback_;                                       // 收到数据回调
+    write_complete_callback write_complete_callback_;                         // 发送完毕回调
+    high_water_mark_callback high_water_mark_callback_;                       // 高水位回调
+    size_t high_water_mark_;                                                  // 高水位
+    uint64_t idle_timeout_ms_;                                                // 空闲超时(毫秒) 0表示不回收空闲连接
+    uint64_t idle_tick_ms_;                                                   // 空闲检测时间轮刻度(毫秒)
+    std::unordered_map<EventLoop *, std::unique_ptr<IdleWheel>> idle_wheels_; // 各事件循环的空闲检测时间轮
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <set>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
+#include <ctime>
+#include <unistd.h>
+#include <sys/timerfd.h>
+#include "channel.hpp"
+#include "loopmetrics.hpp"
+#include "log.hpp"
+
+using timer_callback = std::function<void()>; // 定时器回调函数
+using TimerId = uint64_t;                     // 定时器id 用于取消定时器
+
+// 获取单调时钟的当前时间(微秒)
+inline uint64_t timer_now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 基于timerfd的定时器队列 一个事件循环持有一个
+// timerfd总是设置为最早到期的时间 每次唤醒批量执行所有到期的定时器
+// 添加和取消可在任意线程调用 实际操作转交给所属事件循环线程执行
+class TimerQueue : private ChannelHandler
+{
+public:
+    // metrics: 记录定时器延迟的统计 为空时不记录
+    TimerQueue(EventLoop *loop, LoopMetrics *metrics = nullptr)
+        : loop_(loop), metrics_(metrics), timerfd_(create_timerfd()), channel_(loop, timerfd_), calling_expired_(false)
+    {
+        channel_.set_handler(this);
+        channel_.enable_read();
+    }
+
+    ~TimerQueue()
+    {
+        channel_.remove();
+        close(timerfd_);
+    }
+
+    TimerQueue(const TimerQueue &) = delete;
+    TimerQueue &operator=(const TimerQueue &) = delete;
+
+    // 添加定时器 在when_us时刻执行 interval_us不为0时按该间隔重复执行
+    TimerId add_timer(timer_callback cb, uint64_t when_us, uint64_t interval_us);
+
+    // 取消定时器 定时器已执行或不存在时无任何效果
+    void cancel(TimerId id);
+
+    size_t size() const { return timers_.size(); } // 定时器数量 只能在所属线程中调用
+
+private:
+    struct Timer
+    {
+        timer_callback callback; // 回调函数
+        uint64_t when;           // 到期时间(微秒)
+        uint64_t interval;       // 重复间隔(微秒) 0表示只执行一次
+    };
+
+    using Entry = std::pair<uint64_t, TimerId>; // 到期时间与定时器id 按到期时间排序
+
+    // 创建非阻塞的timerfd
+    static int create_timerfd()
+    {
+        int fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (fd == -1)
+        {
+            LOG_MSG(FATAL, "create timerfd failed!");
+            abort();
+        }
+        return fd;
+    }
+
+    // 在所属线程中添加定时器
+    void add_timer_in_loop(TimerId id, Timer timer)
+    {
+        bool earliest = entries_.empty() || timer.when < entries_.begin()->first;
+        entries_.insert(Entry(timer.when, id));
+        timers_.emplace(id, std::move(timer));
+        if (earliest)
+            reset_timerfd(); // 新定时器最早到期 重新设置timerfd
+    }
+
+    // 在所属线程中取消定时器 requeued: 是否为排在添加任务之后的再次取消
+    void cancel_in_loop(TimerId id, bool requeued = false);
+
+    // timerfd可读 批量执行所有到期的定时器
+    void handle_read() override
+    {
+        uint64_t howmany = 0;
+        if (read(timerfd_, &howmany, sizeof(howmany)) != sizeof(howmany) && errno != EAGAIN)
+            LOG_MSG(ERROR, "read timerfd failed!");
+
+        uint64_t now = timer_now();
+        expired_.clear();
+        auto end = entries_.upper_bound(Entry(now, UINT64_MAX));
+        for (auto it = entries_.begin(); it != end; ++it)
+        {
+            auto timer = timers_.find(it->second);
+            if (metrics_)
+                metrics_->timer_late_us.record(now - it->first);
+            expired_.emplace_back(it->second, std::move(timer->second));
+            timers_.erase(timer);
+        }
+        entries_.erase(entries_.begin(), end);
+
+        calling_expired_ = true;
+        canceling_.clear();
+        for (auto &expired : expired_)
+        {
+            // 同一批中已被前面的回调取消的定时器不再执行
+            if (canceling_.empty() || !canceling_.count(expired.first))
+                expired.second.callback();
+        }
+        calling_expired_ = false;
+
+        // 重复定时器在回调中未被取消时重新加入
+        for (auto &expired : expired_)
+        {
+            Timer &timer = expired.second;
+            if (timer.interval == 0 || canceling_.count(expired.first))
+                continue;
+
+            timer.when += timer.interval;
+            if (timer.when <= now)
+                timer.when = now + timer.interval; // 落后太多时从当前时间重新计时 避免连续补发
+            entries_.insert(Entry(timer.when, expired.first));
+            timers_.emplace(expired.first, std::move(timer));
+        }
+        expired_.clear();
+
+        reset_timerfd();
+    }
+
+    // 将timerfd设置为最早到期的时间 没有定时器时停止timerfd
+    void reset_timerfd()
+    {
+        struct itimerspec value = {};
+        if (!entries_.empty())
+        {
+            uint64_t when = entries_.begin()->first;
+            value.it_value.tv_sec = when / 1000000;
+            value.it_value.tv_nsec = (when % 1000000) * 1000;
+            if (value.it_value.tv_sec == 0 && value.it_value.tv_nsec == 0)
+                value.it_value.tv_nsec = 1; // 全零表示停止 至少设置1纳秒
+        }
+
+        // 绝对时间 已过期的时间会立即触发
+        if (timerfd_settime(timerfd_, TFD_TIMER_ABSTIME, &value, nullptr) == -1)
+            LOG_MSG(ERROR, "timerfd settime failed!");
+    }
+
+private:
+    EventLoop *loop_;                                // 所属事件循环
+    LoopMetrics *metrics_;                           // 运行统计
+    int timerfd_;                                    // 定时器描述符
+    Channel channel_;                                // timerfd对应的Channel
+    std::set<Entry> entries_;                        // 按到期时间排序的定时器
+    std::unordered_map<TimerId, Timer> timers_;      // 定时器id与定时器的映射
+    std::vector<std::pair<TimerId, Timer>> expired_; // 本次到期的定时器
+    std::unordered_set<TimerId> canceling_;          // 执行到期定时器期间被取消的定时器
+    bool calling_expired_;                           // 是否正在执行到期定时器
+    static std::atomic<TimerId> next_id_;            // 下一个定时器id
+};
+
+inline std::atomic<TimerId> TimerQueue::next_id_{1};
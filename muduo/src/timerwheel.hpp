@@ -0,0 +1,270 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include "log.hpp"
+
+using timer_task = std::function<void()>; // 定时器任务回调函数
+
+static const int WHEEL_ROOT_BITS = 8;                            // 第0层槽位数的位数
+static const int WHEEL_LEVEL_BITS = 6;                           // 上层槽位数的位数
+static const int WHEEL_LEVELS = 4;                               // 时间轮层数
+static const uint32_t WHEEL_ROOT_SIZE = 1u << WHEEL_ROOT_BITS;   // 第0层槽位数 256
+static const uint32_t WHEEL_LEVEL_SIZE = 1u << WHEEL_LEVEL_BITS; // 上层槽位数 64
+static const uint32_t WHEEL_NIL = UINT32_MAX;                    // 空节点下标
+
+// 总槽位数
+static const uint32_t WHEEL_SLOTS = WHEEL_ROOT_SIZE + (WHEEL_LEVELS - 1) * WHEEL_LEVEL_SIZE;
+// 时间轮能表示的最大定时刻度数 2^26-1
+static const uint64_t WHEEL_MAX_TICKS = (1ull << (WHEEL_ROOT_BITS + (WHEEL_LEVELS - 1) * WHEEL_LEVEL_BITS)) - 1;
+
+// 分层时间轮 第0层256个槽位每槽1个刻度 之上3层各64个槽位 刻度为1毫秒时可覆盖约18.6小时
+// 定时器节点侵入式链接在槽位链表中 节点存放在对象池里循环复用
+// 添加 刷新 取消都是O(1) 刷新和取消只重新链接节点 不申请内存
+// 只能在单个线程中使用 通常由所属事件循环驱动
+class TimerWheel
+{
+public:
+    // tick_ms: 每个刻度的毫秒数 now_ms: 当前时间(毫秒)
+    TimerWheel(uint64_t tick_ms = 1, uint64_t now_ms = 0)
+        : tick_ms_(tick_ms), current_(now_ms / tick_ms), free_head_(WHEEL_NIL), size_(0)
+    {
+        for (uint32_t i = 0; i < WHEEL_SLOTS; i++)
+            slots_[i] = WHEEL_NIL;
+    }
+
+    TimerWheel(const TimerWheel &) = delete;
+    TimerWheel &operator=(const TimerWheel &) = delete;
+
+    // 预先分配节点 避免运行期间对象池扩容
+    void reserve(size_t count) { nodes_.reserve(count); }
+
+    // 添加定时器 interval_ms毫秒后执行task 返回定时器id 用于刷新与取消
+    uint64_t timer_add(uint64_t interval_ms, timer_task task)
+    {
+        uint32_t index = alloc_node();
+        TimerNode &node = nodes_[index];
+        node.interval = to_ticks(interval_ms);
+        node.task = std::move(task);
+        node.expires = current_ + node.interval;
+        link(index);
+        size_++;
+        return make_id(index, node.generation);
+    }
+
+    // 刷新定时器 重新从当前时间开始计时 定时器不存在时返回false
+    bool refresh_timer(uint64_t id)
+    {
+        uint32_t index = 0;
+        if (!lookup(id, &index))
+            return false;
+
+        unlink(index);
+        nodes_[index].expires = current_ + nodes_[index].interval;
+        link(index);
+        return true;
+    }
+
+    // 取消定时器 任务不再执行 定时器不存在时返回false
+    bool cancel_timer(uint64_t id)
+    {
+        uint32_t index = 0;
+        if (!lookup(id, &index))
+            return false;
+
+        unlink(index);
+        free_node(index);
+        size_--;
+        return true;
+    }
+
+    // 判断定时器是否存在
+    bool has_timer(uint64_t id) const
+    {
+        uint32_t index = 0;
+        return lookup(id, &index);
+    }
+
+    // 时间轮前进一个刻度 执行到期的定时器任务
+    void run_timer_task()
+    {
+        current_++;
+
+        // 第0层转完一圈时 把上层对应槽位中的节点降级到下层
+        uint32_t root_index = current_ & (WHEEL_ROOT_SIZE - 1);
+        for (int level = 1; level < WHEEL_LEVELS && root_index == 0; level++)
+        {
+            uint32_t index = (current_ >> shift(level)) & (WHEEL_LEVEL_SIZE - 1);
+            cascade(slot_of(level, index));
+            root_index = index; // 本层也转完一圈时继续降级更上一层
+        }
+
+        // 逐个摘除当前槽位的节点并执行 新添加或刷新的定时器至少延后1个刻度 不会落入当前槽位
+        uint32_t slot = current_ & (WHEEL_ROOT_SIZE - 1);
+        while (slots_[slot] != WHEEL_NIL)
+        {
+            uint32_t index = slots_[slot];
+            unlink(index);
+
+            // 先释放节点再执行任务 任务中可以安全地添加 刷新或取消定时器
+            timer_task task = std::move(nodes_[index].task);
+            free_node(index);
+            size_--;
+            if (task)
+                task();
+        }
+    }
+
+    // 推进到now_ms 执行期间所有到期的定时器任务
+    void advance(uint64_t now_ms)
+    {
+        uint64_t target = now_ms / tick_ms_;
+        if (size_ == 0 && target > current_)
+        {
+            current_ = target; // 没有定时器时直接跳到目标刻度
+            return;
+        }
+
+        while (current_ < target)
+            run_timer_task();
+    }
+
+    size_t size() const { return size_; }              // 定时器数量
+    uint64_t current_tick() const { return current_; } // 当前刻度
+    uint64_t tick_ms() const { return tick_ms_; }      // 每个刻度的毫秒数
+
+private:
+    // 定时器节点 通过下标链接在槽位链表或空闲链表中
+    struct TimerNode
+    {
+        uint32_t prev = WHEEL_NIL; // 前一个节点
+        uint32_t next = WHEEL_NIL; // 后一个节点
+        uint32_t slot = WHEEL_NIL; // 所在槽位
+        uint32_t generation = 0;   // 节点复用次数 用于识别过期的定时器id
+        uint64_t interval = 0;     // 定时间隔(刻度)
+        uint64_t expires = 0;      // 到期刻度
+        timer_task task;           // 定时器任务
+    };
+
+    static uint64_t make_id(uint32_t index, uint32_t generation) { return (static_cast<uint64_t>(generation) << 32) | index; }
+
+    // 第level层槽位下标对应的刻度位移
+    static int shift(int level) { return WHEEL_ROOT_BITS + (level - 1) * WHEEL_LEVEL_BITS; }
+
+    // 第level层第index个槽位在slots_中的下标
+    static uint32_t slot_of(int level, uint32_t index)
+    {
+        return level == 0 ? index : WHEEL_ROOT_SIZE + (level - 1) * WHEEL_LEVEL_SIZE + index;
+    }
+
+    // 毫秒转换为刻度 向上取整 且至少为1个刻度
+    uint64_t to_ticks(uint64_t ms) const
+    {
+        uint64_t ticks = (ms + tick_ms_ - 1) / tick_ms_;
+        return ticks == 0 ? 1 : ticks;
+    }
+
+    // 根据定时器id查找节点下标
+    bool lookup(uint64_t id, uint32_t *index) const
+    {
+        *index = static_cast<uint32_t>(id);
+        uint32_t generation = static_cast<uint32_t>(id >> 32);
+        return *index < nodes_.size() && nodes_[*index].slot != WHEEL_NIL && nodes_[*index].generation == generation;
+    }
+
+    // 从空闲链表中获取节点 空闲链表为空时扩充对象池
+    uint32_t alloc_node()
+    {
+        if (free_head_ != WHEEL_NIL)
+        {
+            uint32_t index = free_head_;
+            free_head_ = nodes_[index].next;
+            return index;
+        }
+
+        nodes_.emplace_back();
+        return static_cast<uint32_t>(nodes_.size() - 1);
+    }
+
+    // 归还节点到空闲链表 递增复用次数使旧的定时器id失效
+    void free_node(uint32_t index)
+    {
+        TimerNode &node = nodes_[index];
+        node.task = nullptr;
+        node.slot = WHEEL_NIL;
+        node.prev = WHEEL_NIL;
+        node.generation++;
+        node.next = free_head_;
+        free_head_ = index;
+    }
+
+    // 按到期刻度将节点链接到对应的槽位
+    void link(uint32_t index)
+    {
+        TimerNode &node = nodes_[index];
+        uint64_t delta = node.expires - current_;
+        if (delta > WHEEL_MAX_TICKS)
+        {
+            // 超出时间轮范围 先放在最远的槽位 降级时会按真实到期时间重新放置
+            delta = WHEEL_MAX_TICKS;
+        }
+
+        uint64_t expires = current_ + delta;
+        uint32_t slot = 0;
+        if (delta < WHEEL_ROOT_SIZE)
+        {
+            slot = slot_of(0, expires & (WHEEL_ROOT_SIZE - 1));
+        }
+        else
+        {
+            int level = 1;
+            while (level < WHEEL_LEVELS - 1 && delta >= (1ull << shift(level + 1)))
+                level++;
+            slot = slot_of(level, (expires >> shift(level)) & (WHEEL_LEVEL_SIZE - 1));
+        }
+
+        node.slot = slot;
+        node.prev = WHEEL_NIL;
+        node.next = slots_[slot];
+        if (node.next != WHEEL_NIL)
+            nodes_[node.next].prev = index;
+        slots_[slot] = index;
+    }
+
+    // 将节点从所在槽位中摘除
+    void unlink(uint32_t index)
+    {
+        TimerNode &node = nodes_[index];
+        if (node.prev != WHEEL_NIL)
+            nodes_[node.prev].next = node.next;
+        else
+            slots_[node.slot] = node.next;
+
+        if (node.next != WHEEL_NIL)
+            nodes_[node.next].prev = node.prev;
+        node.prev = node.next = WHEEL_NIL;
+    }
+
+    // 将上层槽位中的节点按剩余时间重新放置到下层
+    void cascade(uint32_t slot)
+    {
+        uint32_t head = slots_[slot];
+        slots_[slot] = WHEEL_NIL;
+        while (head != WHEEL_NIL)
+        {
+            uint32_t index = head;
+            head = nodes_[index].next;
+            link(index);
+        }
+    }
+
+private:
+    uint64_t tick_ms_;             // 每个刻度的毫秒数
+    uint64_t current_;             // 当前刻度
+    uint32_t slots_[WHEEL_SLOTS];  // 各槽位链表头
+    std::vector<TimerNode> nodes_; // 节点对象池
+    uint32_t free_head_;           // 空闲链表头
+    size_t size_;                  // 定时器数量
+};
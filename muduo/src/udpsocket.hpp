@@ -0,0 +1,435 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <functional>
+#include <sys/socket.h>
+#include <netinet/udp.h>
+#include "sock.hpp"
+#include "channel.hpp"
+#include "eventloop.hpp"
+#include "log.hpp"
+
+static const size_t UDP_BATCH_SIZE = 64;                        // 每次recvmmsg/sendmmsg的默认消息数
+static const size_t UDP_SLOT_SIZE = 2048;                       // 未开启GRO时每个接收槽的大小 大于以太网MTU
+static const size_t UDP_GRO_SLOT_SIZE = 65536;                  // 开启GRO时每个接收槽的大小 可容纳合并后的最大数据报
+static const size_t UDP_CONTROL_SIZE = CMSG_SPACE(sizeof(int)); // 每条消息的控制信息空间 用于UDP_GRO和UDP_SEGMENT
+static const size_t UDP_MAX_GSO_SIZE = 65507;                   // 一次GSO发送的最大负载
+static const size_t UDP_MAX_SEGMENTS = 64;                      // 一次GSO发送的最大分段数
+static const size_t UDP_GSO_SEGMENT_LIMIT = 1472;               // 默认的最大GSO分段大小 以太网MTU减去IPv4头和UDP头
+static const int UDP_READ_ROUNDS = 16;                          // 每次可读事件最多调用recvmmsg的次数 避免饿死其他描述符
+
+using datagram_callback = std::function<void(std::string_view, const struct sockaddr_in &)>; // 收到数据报回调 参数为数据和对端地址
+
+// 构造IPv4地址
+inline struct sockaddr_in udp_address(const std::string &ip, int port)
+{
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr(ip.c_str());
+    return addr;
+}
+
+// UDP套接字 与事件循环集成 收发都按批进行 每次系统调用处理多个数据报
+// 接收: 可读时以recvmmsg读入预先分配的消息数组 每个数据报回调一次 数据为指向接收槽的视图 只在回调期间有效
+// 发送: send_to只拷贝到待发送区 本轮事件处理完毕后以sendmmsg一次发出 发送缓冲区满时等待可写后继续
+// 开启GRO后内核把同一流的连续数据报合并为一个大数据报交付 按控制信息中的分段大小拆分后逐个回调
+// 开启GSO后发往同一地址的连续等长数据报合并为一条消息 由内核或网卡分段 大幅减少协议栈的逐包开销
+// 所有方法都只能在所属事件循环线程中调用 必须在所属事件循环线程中析构
+class UdpSocket : private ChannelHandler
+{
+public:
+    // 构造函数 创建并绑定非阻塞的UDP套接字 port为0时由内核选择端口
+    // reuse_port: 是否开启端口复用 多个事件循环各自绑定同一端口 由内核按流分发数据报
+    UdpSocket(EventLoop *loop, int port, bool reuse_port = false, const std::string &ip = "0.0.0.0")
+        : loop_(loop), started_(false), batch_size_(UDP_BATCH_SIZE), slot_size_(UDP_SLOT_SIZE), gro_(false), gso_(false),
+          gso_segment_limit_(UDP_GSO_SEGMENT_LIMIT), channel_(loop, create_fd(port, ip, reuse_port)), flush_queued_(false), alive_(std::make_shared<UdpSocket *>(this)),
+          received_(0), recv_calls_(0), sent_(0), send_calls_(0)
+    {
+        channel_.set_handler(this);
+    }
+
+    ~UdpSocket()
+    {
+        if (started_)
+        {
+            channel_.disable_all();
+            channel_.remove();
+        }
+    }
+
+    UdpSocket(const UdpSocket &) = delete;
+    UdpSocket &operator=(const UdpSocket &) = delete;
+
+    // 以下设置必须在start之前调用
+    void set_datagram_callback(const datagram_callback &cb) { datagram_callback_ = cb; }
+    void set_batch_size(size_t count) { batch_size_ = count > 0 ? count : 1; }
+
+    // 开启GRO 接收槽扩大为UDP_GRO_SLOT_SIZE 内存占用为批量大小乘以该值 内核不支持时返回false
+    bool enable_gro()
+    {
+        int opt = 1;
+        if (setsockopt(socket_.GetFd(), IPPROTO_UDP, UDP_GRO, &opt, sizeof(opt)) == -1)
+        {
+            LOG_FMT(WARN, "enable udp gro failed! errno={}", errno);
+            return false;
+        }
+        gro_ = true;
+        slot_size_ = UDP_GRO_SLOT_SIZE;
+        return true;
+    }
+
+    // 开启GSO 内核不支持时返回false 发送时若设备不支持校验和卸载导致失败 自动关闭GSO重发
+    bool enable_gso()
+    {
+        int opt = 0; // 只检测是否支持 分段大小随每条消息指定
+        if (setsockopt(socket_.GetFd(), IPPROTO_UDP, UDP_SEGMENT, &opt, sizeof(opt)) == -1)
+        {
+            LOG_FMT(WARN, "enable udp gso failed! errno={}", errno);
+            return false;
+        }
+        gso_ = true;
+        return true;
+    }
+
+    // 设置参与GSO合并的最大数据报长度 分段加上协议头超过路径MTU时内核拒绝整条消息
+    // 默认按以太网MTU 只在回环或巨帧等MTU更大的路径上调大
+    void set_gso_segment_limit(size_t size) { gso_segment_limit_ = size; }
+
+    // 分配消息数组并开始接收
+    void start()
+    {
+        loop_->assert_in_loop();
+        if (started_)
+            return;
+        started_ = true;
+
+        recv_data_.resize(batch_size_ * slot_size_);
+        recv_control_.resize(batch_size_ * UDP_CONTROL_SIZE);
+        recv_addrs_.resize(batch_size_);
+        recv_iovs_.resize(batch_size_);
+        recv_msgs_.resize(batch_size_);
+        for (size_t i = 0; i < batch_size_; i++)
+        {
+            recv_iovs_[i].iov_base = &recv_data_[i * slot_size_];
+            recv_iovs_[i].iov_len = slot_size_;
+            struct msghdr &hdr = recv_msgs_[i].msg_hdr;
+            bzero(&hdr, sizeof(hdr));
+            hdr.msg_name = &recv_addrs_[i];
+            hdr.msg_iov = &recv_iovs_[i];
+            hdr.msg_iovlen = 1;
+        }
+        send_msgs_.resize(batch_size_);
+        send_iovs_.resize(batch_size_);
+        send_control_.resize(batch_size_ * UDP_CONTROL_SIZE);
+        send_counts_.resize(batch_size_);
+        channel_.enable_read();
+    }
+
+    // 发送数据报 拷贝到待发送区 本轮事件处理完毕后批量发出 待发送数据报达到批量大小时立即发出 必须在start之后调用
+    void send_to(const char *data, size_t len, const struct sockaddr_in &peer)
+    {
+        loop_->assert_in_loop();
+        assert(started_);
+        pending_.push_back(PendingDatagram{send_data_.size(), len, peer});
+        send_data_.append(data, len);
+        if (channel_.write_enabled())
+            return; // 等待可写后统一发送
+
+        if (pending_.size() >= batch_size_)
+        {
+            flush();
+            return;
+        }
+        if (!flush_queued_)
+        {
+            flush_queued_ = true;
+            std::weak_ptr<UdpSocket *> weak(alive_);
+            loop_->queue_in_loop([weak]()
+                                 {
+                std::shared_ptr<UdpSocket *> self = weak.lock();
+                if (self)
+                    (*self)->flush(); });
+        }
+    }
+
+    void send_to(std::string_view data, const struct sockaddr_in &peer) { send_to(data.data(), data.size(), peer); }
+
+    // 立即以sendmmsg发出所有待发送的数据报 发送缓冲区满时保留剩余数据报 等待可写后继续
+    void flush()
+    {
+        loop_->assert_in_loop();
+        flush_queued_ = false;
+
+        size_t next = 0;
+        size_t split_end = 0; // 此前的数据报逐个发送 不再合并
+        while (next < pending_.size())
+        {
+            size_t count = build_messages(next, split_end);
+            int n = sendmmsg(socket_.GetFd(), send_msgs_.data(), count, 0);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                if (errno == EIO && gso_)
+                {
+                    LOG_MSG(WARN, "udp gso not supported by device, disabled");
+                    gso_ = false;
+                    continue;
+                }
+                if ((errno == EINVAL || errno == EMSGSIZE) && send_counts_[0] > 1)
+                {
+                    // 合并后的消息被拒绝(如分段超过路径MTU) 其中的数据报改为逐个重发
+                    LOG_FMT(WARN, "udp gso send rejected! errno={} resend {} datagrams separately", errno, send_counts_[0]);
+                    split_end = next + send_counts_[0];
+                    continue;
+                }
+
+                // 单个数据报出错(如ICMP不可达) 丢弃第一条消息后继续
+                LOG_FMT(ERROR, "udp send failed! errno={}", errno);
+                next += send_counts_[0];
+                continue;
+            }
+
+            send_calls_++;
+            for (int i = 0; i < n; i++)
+            {
+                metric_add(loop_->metrics().bytes_out, send_msgs_[i].msg_len);
+                sent_ += send_counts_[i];
+                next += send_counts_[i];
+            }
+        }
+
+        if (next == pending_.size())
+        {
+            pending_.clear();
+            send_data_.clear();
+            if (channel_.write_enabled())
+                channel_.disable_write();
+            return;
+        }
+
+        // 发送缓冲区已满 压缩剩余的数据报 等待可写
+        size_t base = pending_[next].offset;
+        send_data_.erase(0, base);
+        pending_.erase(pending_.begin(), pending_.begin() + next);
+        for (PendingDatagram &datagram : pending_)
+            datagram.offset -= base;
+        if (!channel_.write_enabled())
+            channel_.enable_write();
+    }
+
+    EventLoop *owner_loop() const { return loop_; }
+    bool valid() const { return socket_.GetFd() != -1; }     // 套接字是否创建成功
+    int fd() const { return socket_.GetFd(); }               // 套接字描述符
+    bool gro_enabled() const { return gro_; }                // 是否开启GRO
+    bool gso_enabled() const { return gso_; }                // 是否开启GSO
+    size_t pending_count() const { return pending_.size(); } // 待发送的数据报数
+    uint64_t received() const { return received_; }          // 收到的数据报数 GRO合并的按拆分后计数
+    uint64_t recv_calls() const { return recv_calls_; }      // 成功的recvmmsg调用次数
+    uint64_t sent() const { return sent_; }                  // 发出的数据报数
+    uint64_t send_calls() const { return send_calls_; }      // 成功的sendmmsg调用次数
+
+    // 本地端口 绑定端口为0时获取内核分配的端口
+    int local_port() const
+    {
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        if (getsockname(socket_.GetFd(), (struct sockaddr *)&addr, &len) == -1)
+            return -1;
+        return ntohs(addr.sin_port);
+    }
+
+private:
+    // 待发送的数据报 数据位于send_data_中
+    struct PendingDatagram
+    {
+        size_t offset;           // 数据在send_data_中的偏移
+        size_t len;              // 数据长度
+        struct sockaddr_in peer; // 对端地址
+    };
+
+    // 创建非阻塞的UDP套接字并绑定
+    int create_fd(int port, const std::string &ip, bool reuse_port)
+    {
+        if (!socket_.Create(SOCK_DGRAM))
+            return -1;
+
+        socket_.NonBlock();
+        socket_.ReuseAddr();
+        if ((reuse_port && !socket_.ReusePort()) || !socket_.Bind(ip, port))
+            socket_.Close();
+        return socket_.GetFd();
+    }
+
+    // 从第first个待发送数据报开始填充最多batch_size_条消息 返回消息数
+    // 开启GSO时发往同一地址的连续数据报 除最后一个外长度相同 合并为一条带UDP_SEGMENT的消息
+    // 长度超过gso_segment_limit_的数据报和下标小于split_end的数据报不合并
+    size_t build_messages(size_t first, size_t split_end)
+    {
+        size_t count = 0;
+        size_t i = first;
+        while (i < pending_.size() && count < batch_size_)
+        {
+            const PendingDatagram &head = pending_[i];
+            size_t segment = head.len;
+            size_t total = head.len;
+            size_t start = i++;
+            if (gso_ && segment > 0 && segment <= gso_segment_limit_ && start >= split_end)
+            {
+                while (i < pending_.size() && i - start < UDP_MAX_SEGMENTS && pending_[i - 1].len == segment &&
+                       pending_[i].len > 0 && pending_[i].len <= segment && total + pending_[i].len <= UDP_MAX_GSO_SIZE &&
+                       same_peer(pending_[i].peer, head.peer))
+                    total += pending_[i++].len;
+            }
+
+            send_iovs_[count].iov_base = &send_data_[head.offset];
+            send_iovs_[count].iov_len = total;
+            struct msghdr &hdr = send_msgs_[count].msg_hdr;
+            bzero(&hdr, sizeof(hdr));
+            hdr.msg_name = const_cast<struct sockaddr_in *>(&head.peer);
+            hdr.msg_namelen = sizeof(head.peer);
+            hdr.msg_iov = &send_iovs_[count];
+            hdr.msg_iovlen = 1;
+            if (i - start > 1)
+            {
+                // 多个分段 以控制信息指定分段大小
+                hdr.msg_control = &send_control_[count * UDP_CONTROL_SIZE];
+                hdr.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+                struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = IPPROTO_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t size = segment;
+                memcpy(CMSG_DATA(cmsg), &size, sizeof(size));
+            }
+            send_counts_[count++] = i - start;
+        }
+        return count;
+    }
+
+    static bool same_peer(const struct sockaddr_in &a, const struct sockaddr_in &b)
+    {
+        return a.sin_port == b.sin_port && a.sin_addr.s_addr == b.sin_addr.s_addr;
+    }
+
+    // 读取GRO控制信息中的分段大小 没有时返回0
+    static size_t gro_segment(struct msghdr &hdr)
+    {
+        for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&hdr, cmsg))
+        {
+            if (cmsg->cmsg_level == IPPROTO_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                int size = 0;
+                memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+                return size;
+            }
+        }
+        return 0;
+    }
+
+    // 可读事件 循环批量接收直到没有数据报或达到轮数上限
+    void handle_read() override
+    {
+        for (int round = 0; round < UDP_READ_ROUNDS; round++)
+        {
+            for (size_t i = 0; i < batch_size_; i++)
+            {
+                struct msghdr &hdr = recv_msgs_[i].msg_hdr;
+                hdr.msg_namelen = sizeof(struct sockaddr_in);
+                hdr.msg_control = gro_ ? &recv_control_[i * UDP_CONTROL_SIZE] : nullptr;
+                hdr.msg_controllen = gro_ ? UDP_CONTROL_SIZE : 0;
+            }
+
+            int n = recvmmsg(socket_.GetFd(), recv_msgs_.data(), batch_size_, 0, nullptr);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    LOG_FMT(ERROR, "udp recv failed! errno={}", errno);
+                return;
+            }
+
+            recv_calls_++;
+            for (int i = 0; i < n; i++)
+                deliver(i);
+            if (static_cast<size_t>(n) < batch_size_)
+                return; // 已读空
+        }
+    }
+
+    // 交付第i个接收槽中的数据 GRO合并的数据报按分段大小拆分
+    void deliver(int i)
+    {
+        struct msghdr &hdr = recv_msgs_[i].msg_hdr;
+        size_t len = recv_msgs_[i].msg_len;
+        metric_add(loop_->metrics().bytes_in, len);
+        if (hdr.msg_flags & MSG_TRUNC)
+        {
+            LOG_FMT(WARN, "udp datagram truncated to {} bytes", len);
+            return;
+        }
+
+        const char *data = static_cast<const char *>(recv_iovs_[i].iov_base);
+        size_t segment = gro_ ? gro_segment(hdr) : 0;
+        if (segment == 0 || segment >= len)
+            segment = len;
+        size_t offset = 0;
+        do
+        {
+            size_t size = std::min(segment, len - offset);
+            received_++;
+            if (datagram_callback_)
+                datagram_callback_(std::string_view(data + offset, size), recv_addrs_[i]);
+            offset += size;
+        } while (offset < len);
+    }
+
+    // 可写事件 继续发送剩余的数据报
+    void handle_write() override { flush(); }
+
+    // 错误事件 记录套接字上的错误 如已连接套接字收到ICMP不可达
+    void handle_error() override
+    {
+        int err = socket_.GetError();
+        if (err != 0)
+            LOG_FMT(WARN, "udp socket error! errno={}", err);
+    }
+
+private:
+    EventLoop *loop_;                            // 所属事件循环
+    bool started_;                               // 是否已开始接收
+    size_t batch_size_;                          // 每次系统调用的消息数
+    size_t slot_size_;                           // 每个接收槽的大小
+    bool gro_;                                   // 是否开启GRO
+    bool gso_;                                   // 是否开启GSO
+    size_t gso_segment_limit_;                   // 参与GSO合并的最大数据报长度
+    Socket socket_;                              // UDP套接字
+    Channel channel_;                            // 套接字对应的Channel
+    std::vector<char> recv_data_;                // 接收槽 batch_size_个 每个slot_size_字节
+    std::vector<char> recv_control_;             // 接收控制信息
+    std::vector<struct sockaddr_in> recv_addrs_; // 接收到的对端地址
+    std::vector<struct iovec> recv_iovs_;        // 接收槽对应的iovec
+    std::vector<struct mmsghdr> recv_msgs_;      // recvmmsg的消息数组
+    std::string send_data_;                      // 待发送的数据
+    std::vector<PendingDatagram> pending_;       // 待发送的数据报
+    std::vector<struct mmsghdr> send_msgs_;      // sendmmsg的消息数组
+    std::vector<struct iovec> send_iovs_;        // 发送消息对应的iovec
+    std::vector<char> send_control_;             // 发送控制信息 用于UDP_SEGMENT
+    std::vector<size_t> send_counts_;            // 每条发送消息包含的数据报数
+    bool flush_queued_;                          // 是否已投递发送任务
+    std::shared_ptr<UdpSocket *> alive_;         // 投递的发送任务持有其弱引用 析构后任务不再执行
+    datagram_callback datagram_callback_;        // 收到数据报回调
+    uint64_t received_;                          // 收到的数据报数
+    uint64_t recv_calls_;                        // recvmmsg调用次数
+    uint64_t sent_;                              // 发出的数据报数
+    uint64_t send_calls_;                        // sendmmsg调用次数
+};
@@ -0,0 +1,320 @@
+#pragma once
+
+#include <vector>
+#include <unordered_map>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "poller.hpp"
+#include "log.hpp"
+
+static const unsigned POLLER_URING_ENTRIES = 1024; // 提交队列大小 完成队列为其2倍
+
+// 要求的内核特性 EXT_ARG用于带超时的等待 NODROP保证完成事件不丢失
+// CQE_SKIP(5.17)用于确认内核支持多次触发的poll(5.13)
+static const unsigned POLLER_URING_FEATURES = IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP | IORING_FEAT_CQE_SKIP;
+
+// 基于io_uring的Poller 以IORING_OP_POLL_ADD监控描述符 与epoll实现服务相同的Channel回调
+// 水平触发的Channel使用单次poll 分发后在下一轮等待前重新提交 效果与epoll水平触发一致
+// 边缘触发的Channel使用多次触发的poll 每次状态变化产生一个完成事件
+// 修改和重新提交的请求先放入提交队列 与等待完成事件合并为一次io_uring_enter调用
+// 直接使用系统调用 不依赖liburing 内核不支持时valid()返回false 由调用者回退到epoll
+class UringPoller : public Poller
+{
+public:
+    UringPoller(unsigned entries = POLLER_URING_ENTRIES)
+        : ring_fd_(-1), ring_ptr_(nullptr), ring_size_(0), sqes_(nullptr), sqes_size_(0),
+          to_submit_(0), next_gen_(0), round_(0)
+    {
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (ring_fd_ == -1)
+        {
+            LOG_FMT(WARN, "io_uring setup failed! errno={}", errno);
+            return;
+        }
+
+        if ((params.features & POLLER_URING_FEATURES) != POLLER_URING_FEATURES ||
+            !(params.features & IORING_FEAT_SINGLE_MMAP) || !map_rings(params))
+        {
+            LOG_MSG(WARN, "io_uring lacks required features!");
+            unmap_rings();
+            return;
+        }
+    }
+
+    ~UringPoller() override { unmap_rings(); }
+
+    // io_uring是否可用
+    bool valid() const { return sqes_ != nullptr; }
+
+    const char *name() const override { return "io_uring"; }
+
+    // 添加或修改描述符的监控事件 事件或触发方式变化时取消旧的poll再提交新的poll
+    void update_event(Channel *channel) override
+    {
+        auto it = watches_.find(channel->fd());
+        if (it == watches_.end())
+        {
+            channels_[channel->fd()] = channel;
+            it = watches_.emplace(channel->fd(), Watch{channel, ++next_gen_, 0, false, false, 0, 0}).first;
+        }
+
+        Watch &watch = it->second;
+        uint32_t mask = poll_mask(channel);
+        bool multishot = channel->events() & EPOLLET;
+        if (watch.armed && (watch.mask != mask || watch.multishot != multishot))
+            disarm(channel->fd(), &watch);
+        if (!watch.armed && mask != 0)
+            arm(channel->fd(), &watch, mask, multishot);
+    }
+
+    // 移除描述符的监控
+    void remove_event(Channel *channel) override
+    {
+        auto it = watches_.find(channel->fd());
+        if (it == watches_.end())
+            return;
+
+        if (it->second.armed)
+            disarm(channel->fd(), &it->second);
+        watches_.erase(it);
+        channels_.erase(channel->fd());
+    }
+
+    // 提交积累的请求并等待完成事件 就绪的Channel追加到active中 timeout: 超时时间(毫秒) -1表示阻塞
+    void poll(std::vector<Channel *> *active, int timeout) override
+    {
+        // 上一轮触发过的单次poll重新提交 仍然就绪的描述符会立即产生完成事件
+        for (const Rearm &rearm : rearms_)
+        {
+            auto it = watches_.find(rearm.fd);
+            if (it == watches_.end() || it->second.gen != rearm.gen || it->second.armed)
+                continue;
+            uint32_t mask = poll_mask(it->second.channel);
+            if (mask != 0)
+                arm(rearm.fd, &it->second, mask, it->second.multishot);
+        }
+        rearms_.clear();
+
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        if (timeout >= 0)
+        {
+            ts.tv_sec = timeout / 1000;
+            ts.tv_nsec = (timeout % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+
+        unsigned wait_nr = timeout == 0 ? 0 : 1;
+        if (enter(to_submit_, wait_nr, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)) == -1 &&
+            errno != ETIME && errno != EINTR && errno != EBUSY)
+            LOG_FMT(ERROR, "io_uring enter failed! errno={}", errno);
+
+        reap(active);
+    }
+
+private:
+    // 描述符的监控状态
+    struct Watch
+    {
+        Channel *channel; // 对应的Channel
+        uint32_t gen;     // 本次监控的代数 编入user_data 用于识别已取消的poll产生的完成事件
+        uint32_t mask;    // 已提交的poll事件
+        bool armed;       // poll是否仍在内核中等待
+        bool multishot;   // 是否为多次触发的poll
+        uint64_t round;   // 最近一次加入就绪列表的轮次 同一轮的多个完成事件合并
+        uint32_t revents; // 本轮合并后的就绪事件
+    };
+
+    // 等待重新提交的单次poll
+    struct Rearm
+    {
+        int fd;       // 描述符
+        uint32_t gen; // 触发时的代数
+    };
+
+    static uint64_t make_user_data(int fd, uint32_t gen) { return (static_cast<uint64_t>(gen) << 32) | static_cast<uint32_t>(fd); }
+
+    // Channel监控事件中poll可识别的部分 触发方式和独占唤醒由提交方式体现
+    static uint32_t poll_mask(Channel *channel) { return channel->events() & ~(EPOLLET | EPOLLEXCLUSIVE); }
+
+    // 映射提交队列 完成队列和提交队列项
+    bool map_rings(const struct io_uring_params &params)
+    {
+        size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        ring_size_ = sq_size > cq_size ? sq_size : cq_size;
+        void *ring = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED)
+            return false;
+        ring_ptr_ = static_cast<char *>(ring);
+
+        sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+        void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+        if (sqes == MAP_FAILED)
+            return false;
+        sqes_ = static_cast<struct io_uring_sqe *>(sqes);
+
+        sq_head_ = reinterpret_cast<unsigned *>(ring_ptr_ + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned *>(ring_ptr_ + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned *>(ring_ptr_ + params.sq_off.ring_mask);
+        sq_entries_ = params.sq_entries;
+        sq_array_ = reinterpret_cast<unsigned *>(ring_ptr_ + params.sq_off.array);
+        cq_head_ = reinterpret_cast<unsigned *>(ring_ptr_ + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned *>(ring_ptr_ + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned *>(ring_ptr_ + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<struct io_uring_cqe *>(ring_ptr_ + params.cq_off.cqes);
+        return true;
+    }
+
+    void unmap_rings()
+    {
+        if (sqes_)
+            munmap(sqes_, sqes_size_);
+        if (ring_ptr_)
+            munmap(ring_ptr_, ring_size_);
+        if (ring_fd_ != -1)
+            close(ring_fd_);
+        sqes_ = nullptr;
+        ring_ptr_ = nullptr;
+        ring_fd_ = -1;
+    }
+
+    int enter(unsigned to_submit, unsigned wait_nr, unsigned flags, void *arg, size_t arg_size)
+    {
+        int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, wait_nr, flags, arg, arg_size));
+        if (ret > 0)
+            to_submit_ -= static_cast<unsigned>(ret); // 返回值为本次消费的提交队列项数量
+        return ret;
+    }
+
+    // 获取一个空闲的提交队列项 队列已满时先提交已有请求
+    struct io_uring_sqe *get_sqe()
+    {
+        unsigned tail = *sq_tail_;
+        while (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+        {
+            if (enter(to_submit_, 0, 0, nullptr, 0) == -1 && errno != EINTR && errno != EBUSY)
+            {
+                LOG_FMT(ERROR, "io_uring submit failed! errno={}", errno);
+                return nullptr;
+            }
+        }
+
+        unsigned index = tail & sq_mask_;
+        struct io_uring_sqe *sqe = &sqes_[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        to_submit_++;
+        return sqe;
+    }
+
+    // 提交poll请求
+    void arm(int fd, Watch *watch, uint32_t mask, bool multishot)
+    {
+        struct io_uring_sqe *sqe = get_sqe();
+        if (sqe == nullptr)
+            return;
+
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = fd;
+        sqe->poll32_events = mask;
+        sqe->len = multishot ? IORING_POLL_ADD_MULTI : 0;
+        sqe->user_data = make_user_data(fd, watch->gen);
+        watch->mask = mask;
+        watch->multishot = multishot;
+        watch->armed = true;
+    }
+
+    // 取消内核中等待的poll 递增代数使其后续的完成事件被忽略
+    void disarm(int fd, Watch *watch)
+    {
+        struct io_uring_sqe *sqe = get_sqe();
+        if (sqe == nullptr)
+            return;
+
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = make_user_data(fd, watch->gen);
+        sqe->user_data = 0; // 取消请求自身的完成事件无需处理
+        watch->gen = ++next_gen_;
+        watch->armed = false;
+    }
+
+    // 处理完成队列 同一轮中同一个描述符的多个完成事件合并为一次分发
+    void reap(std::vector<Channel *> *active)
+    {
+        round_++;
+        unsigned head = *cq_head_;
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++)
+        {
+            const struct io_uring_cqe &cqe = cqes_[head & cq_mask_];
+            if (cqe.user_data == 0)
+                continue;
+
+            int fd = static_cast<int>(static_cast<uint32_t>(cqe.user_data));
+            uint32_t gen = static_cast<uint32_t>(cqe.user_data >> 32);
+            auto it = watches_.find(fd);
+            if (it == watches_.end() || it->second.gen != gen)
+                continue; // 已被取消或移除的poll
+
+            Watch &watch = it->second;
+            if (!(cqe.flags & IORING_CQE_F_MORE))
+            {
+                // poll已结束 单次poll或被内核终止的多次触发poll需要重新提交
+                watch.armed = false;
+                rearms_.push_back(Rearm{fd, gen});
+            }
+
+            if (cqe.res < 0)
+            {
+                if (cqe.res != -ECANCELED)
+                    LOG_FMT(ERROR, "io_uring poll failed! fd={} errno={}", fd, -cqe.res);
+                continue;
+            }
+
+            if (watch.round != round_)
+            {
+                watch.round = round_;
+                watch.revents = 0;
+                active->push_back(watch.channel);
+            }
+            watch.revents |= static_cast<uint32_t>(cqe.res);
+            watch.channel->set_revents(watch.revents);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    }
+
+private:
+    int ring_fd_;               // io_uring描述符
+    char *ring_ptr_;            // 提交队列与完成队列的映射地址
+    size_t ring_size_;          // 队列映射大小
+    struct io_uring_sqe *sqes_; // 提交队列项数组
+    size_t sqes_size_;          // 提交队列项映射大小
+
+    unsigned *sq_head_;         // 提交队列头 由内核推进
+    unsigned *sq_tail_;         // 提交队列尾 由本端推进
+    unsigned sq_mask_;          // 提交队列下标掩码
+    unsigned sq_entries_;       // 提交队列大小
+    unsigned *sq_array_;        // 提交队列下标数组
+    unsigned *cq_head_;         // 完成队列头 由本端推进
+    unsigned *cq_tail_;         // 完成队列尾 由内核推进
+    unsigned cq_mask_;          // 完成队列下标掩码
+    struct io_uring_cqe *cqes_; // 完成队列项数组
+
+    unsigned to_submit_;                     // 尚未提交给内核的请求数
+    uint32_t next_gen_;                      // 下一个监控代数
+    uint64_t round_;                         // 当前处理轮次
+    std::unordered_map<int, Watch> watches_; // 描述符与监控状态的映射
+    std::vector<Rearm> rearms_;              // 等待重新提交的单次poll
+};
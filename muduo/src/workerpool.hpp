@@ -0,0 +1,235 @@
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <type_traits>
+#include "eventloop.hpp"
+#include "log.hpp"
+
+using work_func = std::function<void()>; // 在工作线程中执行的任务
+
+// 任务优先级 工作线程总是先执行所有延迟敏感的任务 再执行批处理任务
+enum class TaskPriority
+{
+    LATENCY, // 延迟敏感 如请求处理
+    BATCH,   // 批处理 如压缩 报表
+};
+
+static const int WORKER_PRIORITY_COUNT = 2; // 优先级数量
+
+// 工作窃取线程池 用于把耗时的计算移出事件循环线程 避免阻塞同一事件循环上的其他连接
+// 工作线程中提交的任务放入本线程的双端队列 自己从队尾取 保持局部性 空闲时从其他线程的队首窃取
+// 其他线程提交的任务放入共享的注入队列 同一优先级内按提交顺序先进先出 早提交的任务不会被后来者饿死
+// 延迟敏感与批处理任务互不干扰时也可以分别创建两个线程池
+class WorkerPool
+{
+public:
+    WorkerPool(int thread_count) : thread_count_(thread_count > 0 ? thread_count : 1), queued_(0), sleepers_(0),
+                                   stopping_(false), stolen_(0) {}
+
+    // 析构函数 执行完已提交的任务后结束所有工作线程
+    ~WorkerPool() { stop(); }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // 启动工作线程
+    void start()
+    {
+        assert(workers_.empty());
+        for (int i = 0; i < thread_count_; i++)
+            workers_.emplace_back(new Worker());
+        for (int i = 0; i < thread_count_; i++)
+            workers_[i]->thread = std::thread(std::bind(&WorkerPool::worker_entry, this, i));
+    }
+
+    // 停止线程池 已提交的任务全部执行完毕后返回 之后不能再提交任务
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            if (stopping_)
+                return;
+            stopping_ = true;
+        }
+        sleep_cond_.notify_all();
+        for (std::unique_ptr<Worker> &worker : workers_)
+        {
+            if (worker->thread.joinable())
+                worker->thread.join();
+        }
+    }
+
+    // 提交任务 可在任意线程调用
+    void submit(work_func task, TaskPriority priority = TaskPriority::LATENCY)
+    {
+        // 工作线程中提交时放入本线程队列 保持局部性 空闲的线程会来窃取 其他线程提交时放入注入队列
+        // 持锁计数 保证计数先于取走该任务时的减少
+        assert(!workers_.empty());
+        if (current_pool_ == this)
+        {
+            Worker &worker = *workers_[current_index_];
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.queues[static_cast<int>(priority)].push_back(std::move(task));
+            queued_.fetch_add(1, std::memory_order_seq_cst);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(inject_mutex_);
+            injected_[static_cast<int>(priority)].push_back(std::move(task));
+            queued_.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        // 与工作线程等待前先登记再检查计数的顺序配合 不会丢失唤醒
+        if (sleepers_.load(std::memory_order_seq_cst) > 0)
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            sleep_cond_.notify_one();
+        }
+    }
+
+    // 在工作线程中执行work 完成后在loop线程中以work的返回值调用done work无返回值时done不带参数
+    // 通常由事件循环线程提交 done中可以安全地访问连接并发送应答
+    template <typename Work, typename Done>
+    void submit(EventLoop *loop, Work work, Done done, TaskPriority priority = TaskPriority::LATENCY)
+    {
+        submit([loop, work, done]() mutable
+               {
+            if constexpr (std::is_void<decltype(work())>::value)
+            {
+                work();
+                loop->queue_in_loop(std::move(done));
+            }
+            else
+            {
+                auto result = work();
+                loop->queue_in_loop([done, result]() mutable
+                                    { done(std::move(result)); });
+            } },
+               priority);
+    }
+
+    int thread_count() const { return thread_count_; }                          // 工作线程数量
+    size_t queued() const { return queued_.load(std::memory_order_relaxed); }   // 等待执行的任务数
+    uint64_t stolen() const { return stolen_.load(std::memory_order_relaxed); } // 被窃取执行的任务数
+
+private:
+    // 工作线程 队列由mutex保护 自己和窃取方只在存取任务的瞬间持有锁
+    struct alignas(64) Worker
+    {
+        std::mutex mutex;                                    // 保护queues
+        std::deque<work_func> queues[WORKER_PRIORITY_COUNT]; // 按优先级划分的任务队列
+        std::thread thread;                                  // 工作线程
+    };
+
+    // 工作线程入口
+    void worker_entry(size_t index)
+    {
+        current_pool_ = this;
+        current_index_ = index;
+
+        work_func task;
+        while (true)
+        {
+            if (take_task(index, &task))
+            {
+                task();
+                task = nullptr; // 尽快释放任务持有的资源
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            sleepers_.fetch_add(1, std::memory_order_seq_cst);
+            sleep_cond_.wait(lock, [this]()
+                             { return stopping_ || queued_.load(std::memory_order_seq_cst) > 0; });
+            sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+            if (stopping_ && queued_.load(std::memory_order_seq_cst) == 0)
+                break;
+        }
+
+        current_pool_ = nullptr;
+    }
+
+    // 按优先级取任务 每个优先级先从本线程队尾取 再从注入队列队首取 最后从其他线程队首窃取
+    bool take_task(size_t index, work_func *task)
+    {
+        for (int priority = 0; priority < WORKER_PRIORITY_COUNT; priority++)
+        {
+            if (pop_back(*workers_[index], priority, task) || pop_injected(priority, task))
+                return true;
+
+            for (size_t i = 1; i < workers_.size(); i++)
+            {
+                if (pop_front(*workers_[(index + i) % workers_.size()], priority, task))
+                {
+                    stolen_.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool pop_back(Worker &worker, int priority, work_func *task)
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        std::deque<work_func> &queue = worker.queues[priority];
+        if (queue.empty())
+            return false;
+
+        *task = std::move(queue.back());
+        queue.pop_back();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool pop_front(Worker &worker, int priority, work_func *task)
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        std::deque<work_func> &queue = worker.queues[priority];
+        if (queue.empty())
+            return false;
+
+        *task = std::move(queue.front());
+        queue.pop_front();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool pop_injected(int priority, work_func *task)
+    {
+        std::lock_guard<std::mutex> lock(inject_mutex_);
+        std::deque<work_func> &queue = injected_[priority];
+        if (queue.empty())
+            return false;
+
+        *task = std::move(queue.front());
+        queue.pop_front();
+        queued_.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+private:
+    int thread_count_;                                      // 工作线程数量
+    std::vector<std::unique_ptr<Worker>> workers_;          // 工作线程
+    std::mutex inject_mutex_;                               // 保护injected_
+    std::deque<work_func> injected_[WORKER_PRIORITY_COUNT]; // 其他线程提交的任务 按优先级划分 先进先出
+    std::atomic<size_t> queued_;                            // 等待执行的任务数
+    std::atomic<int> sleepers_;                             // 正在等待任务的工作线程数
+    std::mutex sleep_mutex_;                                // 配合sleep_cond_使用 保护stopping_
+    std::condition_variable sleep_cond_;                    // 没有任务时工作线程在此等待
+    bool stopping_;                                         // 是否正在停止
+    std::atomic<uint64_t> stolen_;                          // 被窃取执行的任务数
+
+    static thread_local WorkerPool *current_pool_; // 当前线程所属的线程池 非工作线程为空
+    static thread_local size_t current_index_;     // 当前工作线程的下标
+};
+
+inline thread_local WorkerPool *WorkerPool::current_pool_ = nullptr;
+inline thread_local size_t WorkerPool::current_index_ = 0;
@@ -1,3 +1,4 @@
+#include <sys/socket.h>
 #include "../../src/buffer.hpp"
 #include "../../src/log.hpp"
 
@@ -78,5 +79,92 @@ int main()
     else
         LOG_MSG(INFO, "find_crlf with no CRLF passed.");
 
+    // 测试从描述符读取 数据超出后沿空闲空间时溢出部分追加到缓冲区
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    std::string payload(20000, 'b');
+    ::write(fds[1], payload.data(), payload.size());
+    Buffer fd_buffer;
+    int saved_errno = 0;
+    ssize_t n = fd_buffer.read_from_fd(fds[0], &saved_errno);
+    if (n != static_cast<ssize_t>(payload.size()) || fd_buffer.read_string(n) != payload)
+        LOG_MSG(ERROR, "read_from_fd failed.");
+    else
+        LOG_MSG(INFO, "read_from_fd passed.");
+
+    // 测试将可读数据写入描述符
+    fd_buffer.write_string("write to fd");
+    n = fd_buffer.write_to_fd(fds[1], &saved_errno);
+    char fd_data[32] = {0};
+    if (n != 11 || fd_buffer.readable_size() != 0 || ::read(fds[0], fd_data, sizeof(fd_data)) != 11 || strcmp(fd_data, "write to fd") != 0)
+        LOG_MSG(ERROR, "write_to_fd failed.");
+    else
+        LOG_MSG(INFO, "write_to_fd passed.");
+    close(fds[0]);
+    close(fds[1]);
+
+    // 测试从内存池分配存储空间 连接关闭后存储空间归还内存池并被复用
+    BufferPool pool;
+    {
+        Buffer pooled(1000, &pool);
+        pooled.write_string("pooled");
+        if (pooled.capacity() != 1024 || pool.stats().misses != 1 || pool.stats().in_use_bytes != 1024)
+            LOG_MSG(ERROR, "pool allocate failed.");
+        else
+            LOG_MSG(INFO, "pool allocate passed.");
+
+        // 扩容时按尺寸等级申请新空间 只拷贝可读数据
+        std::string grow(3000, 'g');
+        pooled.write_string(grow);
+        if (pooled.capacity() != 4096 || pooled.read_string(6) != "pooled" || pooled.read_string(grow.size()) != grow)
+            LOG_MSG(ERROR, "pool grow failed.");
+        else
+            LOG_MSG(INFO, "pool grow passed.");
+    }
+    Buffer reused(1024, &pool);
+    if (pool.stats().hits != 1 || pool.stats().in_use_bytes != 1024 || pool.stats().cached_bytes != 4096)
+        LOG_MSG(ERROR, "pool reuse failed.");
+    else
+        LOG_MSG(INFO, "pool reuse passed.");
+
+    // 测试网络字节序整数的写入 查看和读取
+    Buffer ints;
+    ints.write_uint8(0x12);
+    ints.write_uint16(0x1234);
+    ints.write_uint32(0x12345678);
+    ints.write_uint64(0x123456789abcdef0ULL);
+    bool ints_ok = ints.readable_size() == 15 && static_cast<unsigned char>(ints.begin_read()[1]) == 0x12 &&
+                   ints.peek_uint8() == 0x12 && ints.read_uint8() == 0x12 && ints.read_uint16() == 0x1234 &&
+                   ints.peek_uint32() == 0x12345678 && ints.read_uint32() == 0x12345678 &&
+                   ints.read_uint64() == 0x123456789abcdef0ULL && ints.readable_size() == 0;
+    if (!ints_ok)
+        LOG_MSG(ERROR, "network integer failed.");
+    else
+        LOG_MSG(INFO, "network integer passed.");
+
+    // 测试在消息体前补写长度头 使用预留空间时不搬移消息体 预留空间不足时重新申请
+    Buffer framed;
+    framed.write_string("payload");
+    const char *body = framed.begin_read();
+    framed.prepend_uint32(7);
+    bool prepend_ok = framed.begin_read() + 4 == body && framed.read_uint32() == 7 && framed.read_string(7) == "payload";
+    framed.write_string("body");
+    framed.prepend_uint64(1);
+    framed.prepend_uint64(2);
+    prepend_ok = prepend_ok && framed.read_uint64() == 2 && framed.read_uint64() == 1 && framed.read_string(4) == "body";
+
+    // 补写的数据超出前沿空闲空间 重新申请后补写的数据在前 原有数据不变
+    Buffer grown;
+    grown.write_string("payload");
+    const char header[] = "0123456789abcdef";
+    bool need_grow = grown.head_free_size() < 16;
+    grown.prepend(header, 16);
+    prepend_ok = prepend_ok && need_grow && grown.readable_size() == 23 &&
+                 grown.read_string(16) == "0123456789abcdef" && grown.read_string(7) == "payload";
+    if (!prepend_ok)
+        LOG_MSG(ERROR, "prepend failed.");
+    else
+        LOG_MSG(INFO, "prepend passed.");
+
     LOG_MSG(INFO, "Buffer test finished.");
 }
\ No newline at end of file
@@ -0,0 +1,179 @@
+#include <poll.h>
+#include <sys/socket.h>
+#include "../../src/sock.hpp"
+#include "../../src/chainbuffer.hpp"
+#include "../../src/log.hpp"
+
+int main()
+{
+    // 测试跨数据块写入 数据按定长数据块存放
+    ChainBuffer buffer(16);
+    std::string data = "0123456789abcdefghijklmnopqrstuvwxyz";
+    buffer.write_string(data);
+    if (buffer.readable_size() != data.size() || buffer.slice_count() != 3 || buffer.to_string() != data)
+        LOG_MSG(ERROR, "chain write failed.");
+    else
+        LOG_MSG(INFO, "chain write passed.");
+
+    // 测试丢弃数据
+    buffer.consume(20);
+    if (buffer.readable_size() != data.size() - 20 || buffer.to_string() != data.substr(20))
+        LOG_MSG(ERROR, "chain consume failed.");
+    else
+        LOG_MSG(INFO, "chain consume passed.");
+
+    // 测试零拷贝共享 共享后的数据块不再被追加写入
+    ChainBuffer payload;
+    payload.write_string("broadcast");
+    ChainBuffer out1, out2;
+    out1.append_chain(payload);
+    out2.append_chain(payload);
+    out1.write_string("!");
+    if (out1.to_string() != "broadcast!" || out2.to_string() != "broadcast" || out1.slice_count() != 2)
+        LOG_MSG(ERROR, "chain share failed.");
+    else
+        LOG_MSG(INFO, "chain share passed.");
+
+    // 测试引用计数 所有引用释放后数据块才会释放
+    BlockRef block(ChainBlock::create(64));
+    block->append("refcount", 8);
+    {
+        ChainBuffer holder;
+        holder.append_slice(block, 0, 8);
+        if (block->use_count() != 2)
+            LOG_MSG(ERROR, "block ref failed.");
+        else
+            LOG_MSG(INFO, "block ref passed.");
+    }
+    if (block->use_count() != 1)
+        LOG_MSG(ERROR, "block unref failed.");
+    else
+        LOG_MSG(INFO, "block unref passed.");
+
+    // 测试writev发送多个数据块
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    ChainBuffer output(1024);
+    std::string big(10000, 'x');
+    output.write_string(big);
+    output.append_chain(payload);
+    int saved_errno = 0;
+    ssize_t n = output.write_to_fd(fds[1], &saved_errno);
+    std::string received(n, '\0');
+    ::read(fds[0], &received[0], n);
+    if (n != static_cast<ssize_t>(big.size() + 9) || !output.empty() || received != big + "broadcast")
+        LOG_MSG(ERROR, "chain write_to_fd failed.");
+    else
+        LOG_MSG(INFO, "chain write_to_fd passed.");
+    close(fds[0]);
+    close(fds[1]);
+
+    // 测试文件数据段与内存数据穿插发送 发送缓冲区很小时处理部分发送和EAGAIN
+    char path[] = "/tmp/chainbuffer_fileXXXXXX";
+    int file_fd = mkstemp(path);
+    std::string content(300000, '\0');
+    for (size_t i = 0; i < content.size(); i++)
+        content[i] = static_cast<char>('a' + i % 26);
+    ::write(file_fd, content.data(), content.size());
+    int pipe_fds[2];
+    pipe(pipe_fds);
+    ::write(pipe_fds[1], "piped data", 10);
+
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    int sndbuf = 4096;
+    setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    ChainBuffer mixed;
+    mixed.write_string("head|");
+    mixed.append_file(file_fd, 100, content.size() - 100);
+    mixed.write_string("|middle|");
+    mixed.append_file(pipe_fds[0], 0, 10);
+    mixed.write_string("|tail");
+    close(file_fd);
+    unlink(path);
+    close(pipe_fds[0]);
+    std::string expected = "head|" + content.substr(100) + "|middle|piped data|tail";
+
+    std::string sent;
+    bool blocked = false;
+    while (!mixed.empty())
+    {
+        ssize_t n = mixed.write_to_fd(fds[1], &saved_errno);
+        if (n < 0)
+        {
+            if (saved_errno != EAGAIN)
+                break;
+            blocked = true;
+
+            // 发送缓冲区已满 读出对端数据后继续发送
+            char buf[65536];
+            ssize_t r = 0;
+            while ((r = ::read(fds[0], buf, sizeof(buf))) > 0)
+                sent.append(buf, r);
+        }
+    }
+    char buf[65536];
+    ssize_t r = 0;
+    while ((r = ::read(fds[0], buf, sizeof(buf))) > 0)
+        sent.append(buf, r);
+    if (sent != expected || !blocked)
+        LOG_MSG(ERROR, "chain append_file failed.");
+    else
+        LOG_MSG(INFO, "chain append_file passed.");
+    close(pipe_fds[1]);
+    close(fds[0]);
+    close(fds[1]);
+
+    // 测试MSG_ZEROCOPY发送 回环地址上内核会拷贝数据并在完成通知中注明 此后改回拷贝发送
+    {
+        Socket server;
+        server.CreateServer(8897, "127.0.0.1");
+        Socket client;
+        client.Create();
+        client.Connect("127.0.0.1", 8897);
+        int conn = server.Accept();
+
+        ChainBuffer zc;
+        bool enabled = zc.enable_zerocopy(client.GetFd());
+        std::string small(100, 's');
+        zc.write_string(small);
+        zc.write_to_fd(client.GetFd(), &saved_errno);
+        size_t small_pending = zc.zerocopy_pending(); // 小数据拷贝发送 不等待完成通知
+
+        std::string large(64 * 1024, 'z');
+        BlockRef pinned(ChainBlock::create(large.size()));
+        pinned->append(large.data(), large.size());
+        zc.append_slice(pinned, 0, large.size());
+        while (!zc.empty() && zc.write_to_fd(client.GetFd(), &saved_errno) > 0)
+            ;
+        bool held = pinned->use_count() > 1; // 完成通知到达前数据块被内核引用
+
+        std::string received;
+        char buf[65536];
+        while (received.size() < small.size() + large.size())
+        {
+            ssize_t r = ::read(conn, buf, sizeof(buf));
+            if (r <= 0)
+                break;
+            received.append(buf, r);
+        }
+
+        // 等待错误队列中的完成通知
+        struct pollfd pfd = {client.GetFd(), 0, 0};
+        for (int i = 0; i < 100 && zc.zerocopy_pending() > 0; i++)
+        {
+            poll(&pfd, 1, 10);
+            zc.reap_zerocopy(client.GetFd());
+        }
+
+        if (!enabled)
+            LOG_MSG(WARN, "zerocopy not supported, skipped.");
+        else if (small_pending != 0 || !held || zc.zerocopy_pending() != 0 || pinned->use_count() != 1 ||
+                 received != small + large || zc.zerocopy_copied() == 0 || zc.zerocopy_enabled())
+            LOG_MSG(ERROR, "chain zerocopy failed.");
+        else
+            LOG_MSG(INFO, "chain zerocopy passed.");
+        close(conn);
+    }
+
+    LOG_MSG(INFO, "ChainBuffer test finished.");
+}
@@ -0,0 +1,125 @@
+#include <string>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include "../../src/eventloop.hpp"
+#include "../../src/log.hpp"
+
+// 在指定Poller实现上测试事件分发
+void test_dispatch(const std::string &expected_poller)
+{
+    EventLoop loop;
+    if (loop.poller_name() != expected_poller)
+        LOG_MSG(ERROR, "poller selection failed.");
+    else
+        LOG_FMT(INFO, "poller selection passed. poller={}", loop.poller_name());
+
+    int fds[2];
+    if (pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1)
+    {
+        LOG_MSG(ERROR, "create pipe failed.");
+        return;
+    }
+
+    // 测试水平触发 读事件回调被调用
+    int read_count = 0;
+    CallbackChannel channel(&loop, fds[0]);
+    channel.set_read_callback([&]()
+                              {
+        char buf[16];
+        read(fds[0], buf, 1); // 每次只读1字节 水平触发下剩余数据会再次触发
+        if (++read_count == 3)
+            loop.quit(); });
+    channel.enable_read();
+    if (!loop.has_channel(&channel))
+        LOG_MSG(ERROR, "update_event failed.");
+    else
+        LOG_MSG(INFO, "update_event passed.");
+
+    write(fds[1], "abc", 3);
+    loop.loop();
+    if (read_count != 3)
+        LOG_MSG(ERROR, "level triggered dispatch failed.");
+    else
+        LOG_MSG(INFO, "level triggered dispatch passed.");
+
+    // 测试边缘触发 一次写入只触发一次读事件
+    channel.disable_all();
+    channel.enable_et();
+    int et_count = 0;
+    channel.set_read_callback([&]()
+                              {
+        char buf[1];
+        read(fds[0], buf, 1); // 只读1字节 边缘触发下不会因剩余数据再次触发
+        et_count++; });
+    channel.enable_read();
+
+    // 写事件回调用于在若干轮后退出循环
+    int rounds = 0;
+    CallbackChannel writer(&loop, fds[1]);
+    writer.set_write_callback([&]()
+                              {
+        if (++rounds == 5)
+            loop.quit(); });
+    writer.enable_write();
+
+    write(fds[1], "xyz", 3);
+    loop.loop();
+    if (et_count != 1)
+        LOG_MSG(ERROR, "edge triggered dispatch failed.");
+    else
+        LOG_MSG(INFO, "edge triggered dispatch passed.");
+
+    // 测试移除监控
+    writer.remove();
+    channel.remove();
+    if (loop.has_channel(&channel) || loop.has_channel(&writer))
+        LOG_MSG(ERROR, "remove_event failed.");
+    else
+        LOG_MSG(INFO, "remove_event passed.");
+
+    close(fds[0]);
+    close(fds[1]);
+
+    // 测试读写事件同时就绪时 每个回调只调用一次
+    int pair[2];
+    socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, pair);
+    write(pair[1], "ping", 4);
+    int reads = 0, writes = 0, events = 0;
+    CallbackChannel both(&loop, pair[0]);
+    both.set_read_callback([&]()
+                           {
+        char buf[16];
+        read(pair[0], buf, sizeof(buf));
+        reads++; });
+    both.set_write_callback([&]()
+                            {
+        writes++;
+        both.disable_all();
+        loop.quit(); });
+    both.set_event_callback([&]()
+                            { events++; });
+    both.enable_read();
+    both.enable_write();
+    loop.loop();
+    both.remove();
+    if (reads != 1 || writes != 1 || events != 1)
+        LOG_MSG(ERROR, "dispatch once failed.");
+    else
+        LOG_MSG(INFO, "dispatch once passed.");
+    close(pair[0]);
+    close(pair[1]);
+}
+
+int main()
+{
+    // 默认使用epoll 清除调用者环境中可能设置的环境变量
+    unsetenv("MUDUO_USE_URING");
+    test_dispatch("epoll");
+
+    // 设置环境变量后使用io_uring 与epoll服务相同的Channel回调
+    setenv("MUDUO_USE_URING", "1", 1);
+    test_dispatch("io_uring");
+    unsetenv("MUDUO_USE_URING");
+
+    LOG_MSG(INFO, "EventLoop test finished.");
+}
@@ -0,0 +1,101 @@
+#include <string>
+#include <thread>
+#include <chrono>
+#include "../../src/eventloop.hpp"
+#include "../../src/tcpserver.hpp"
+#include "../../src/statsserver.hpp"
+#include "../../src/log.hpp"
+
+// 阻塞地连接服务器 返回客户端描述符
+static int connect_client(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+        LOG_MSG(ERROR, "connect failed.");
+    return fd;
+}
+
+int main()
+{
+    // 测试事件循环自身的统计 唤醒次数 任务数 每轮任务数和定时器延迟
+    {
+        EventLoop loop;
+        std::thread producer([&loop]()
+                             {
+            for (int i = 0; i < 3; i++)
+                loop.queue_in_loop([]() {}); });
+        producer.join();
+        loop.run_after(20 * 1000, [&loop]()
+                       { loop.quit(); });
+        loop.loop();
+
+        const LoopMetrics &metrics = loop.metrics();
+        if (metrics.wakeups.load() == 0 || metrics.tasks.load() < 3 || metrics.task_batch.max() < 3 || metrics.timer_late_us.count() != 1 || metrics.wait_ns.load() == 0)
+            LOG_MSG(ERROR, "loop metrics failed.");
+        else
+            LOG_MSG(INFO, "loop metrics passed.");
+    }
+
+    // 测试连接统计与统计服务 回显100字节后通过HTTP读取统计文本
+    {
+        EventLoop base_loop;
+        TcpServer server(&base_loop, 8902);
+        server.set_thread_count(1);
+        server.set_message_callback([](const TcpConnectionPtr &conn, Buffer *buffer)
+                                    { conn->send(buffer); });
+        server.start();
+
+        StatsServer stats(&base_loop, 8903);
+        stats.add_loop(&base_loop);
+        stats.add_loops(server.all_loops());
+        stats.start();
+
+        std::string response;
+        std::thread client([&]()
+                           {
+            int echo = connect_client(8902);
+            char buf[100] = {0};
+            write(echo, buf, sizeof(buf));
+            size_t got = 0;
+            while (got < sizeof(buf))
+            {
+                ssize_t n = read(echo, buf, sizeof(buf) - got);
+                if (n <= 0)
+                    break;
+                got += n;
+            }
+
+            // 客户端收到回显时服务端可能还未记录写出的字节数 稍等片刻再读取统计
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            int fd = connect_client(8903);
+            const char request[] = "GET /stats HTTP/1.0\r\n\r\n";
+            write(fd, request, sizeof(request) - 1);
+            char chunk[4096];
+            ssize_t n;
+            while ((n = read(fd, chunk, sizeof(chunk))) > 0)
+                response.append(chunk, n);
+            close(fd);
+            close(echo);
+            base_loop.quit(); });
+
+        base_loop.loop();
+        client.join();
+
+        bool ok = response.compare(0, 15, "HTTP/1.0 200 OK") == 0 &&
+                  response.find("loop1.bytes_in 100\n") != std::string::npos &&
+                  response.find("loop1.bytes_out 100\n") != std::string::npos &&
+                  response.find("loop1.connections 1\n") != std::string::npos &&
+                  response.find("loop0.connections 1\n") != std::string::npos; // 统计服务自身的连接
+        if (!ok)
+            LOG_FMT(ERROR, "stats server failed. response={}", response);
+        else
+            LOG_MSG(INFO, "stats server passed.");
+    }
+
+    LOG_MSG(INFO, "Metrics test finished.");
+}
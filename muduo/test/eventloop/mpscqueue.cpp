@@ -0,0 +1,82 @@
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <future>
+#include "../../src/mpscqueue.hpp"
+#include "../../src/eventloop.hpp"
+#include "../../src/loopthread.hpp"
+#include "../../src/log.hpp"
+
+static const int PRODUCER_COUNT = 4;          // 生产者线程数
+static const int ITEMS_PER_PRODUCER = 250000; // 每个生产者压入的元素数
+
+int main()
+{
+    // 测试多生产者并发压入 单消费者取出 每个生产者的元素保持先进先出
+    {
+        MpscQueue<uint64_t> queue;
+        std::atomic<int> done(0);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < PRODUCER_COUNT; p++)
+            producers.emplace_back([&queue, &done, p]()
+                                   {
+                for (uint64_t i = 0; i < ITEMS_PER_PRODUCER; i++)
+                    queue.push(static_cast<uint64_t>(p) << 32 | i);
+                done++; });
+
+        std::vector<uint64_t> next(PRODUCER_COUNT, 0);
+        bool ordered = true;
+        uint64_t received = 0, value = 0;
+        while (done < PRODUCER_COUNT || !queue.empty())
+        {
+            while (queue.pop(&value))
+            {
+                int p = value >> 32;
+                ordered = ordered && (value & 0xffffffff) == next[p];
+                next[p]++;
+                received++;
+            }
+        }
+        for (std::thread &producer : producers)
+            producer.join();
+
+        if (!ordered || received != PRODUCER_COUNT * ITEMS_PER_PRODUCER)
+            LOG_MSG(ERROR, "mpsc queue failed.");
+        else
+            LOG_MSG(INFO, "mpsc queue passed.");
+    }
+
+    // 测试跨线程投递任务 全部任务在事件循环线程中执行 一次唤醒覆盖一批任务
+    {
+        EventLoopThread thread;
+        EventLoop *loop = thread.start();
+        uint64_t executed = 0; // 只在事件循环线程中修改
+        bool in_loop = true;
+
+        std::vector<std::thread> producers;
+        for (int p = 0; p < PRODUCER_COUNT; p++)
+            producers.emplace_back([&]()
+                                   {
+                for (int i = 0; i < ITEMS_PER_PRODUCER; i++)
+                    loop->queue_in_loop([&]()
+                                        {
+                        in_loop = in_loop && loop->is_in_loop_thread();
+                        executed++; }); });
+        for (std::thread &producer : producers)
+            producer.join();
+
+        // 最后投递的任务执行时之前的任务都已执行
+        std::promise<uint64_t> result;
+        loop->queue_in_loop([&]()
+                            { result.set_value(executed); });
+        uint64_t total = result.get_future().get();
+        uint64_t writes = loop->metrics().wakeup_writes.load();
+
+        if (!in_loop || total != PRODUCER_COUNT * ITEMS_PER_PRODUCER || writes >= total)
+            LOG_MSG(ERROR, "cross thread post failed.");
+        else
+            LOG_FMT(INFO, "cross thread post passed. tasks={} wakeups={}", total, writes);
+    }
+
+    LOG_MSG(INFO, "MpscQueue test finished.");
+}
@@ -0,0 +1,94 @@
+#include <cstdlib>
+#include "../../src/httpparser.hpp"
+#include "../../src/log.hpp"
+
+int main()
+{
+    // 测试向量化扫描与标量实现结果一致 覆盖各种长度和位置
+    bool scan_ok = true;
+    DelimiterSet delims(":;\r");
+    for (int round = 0; round < 2000 && scan_ok; round++)
+    {
+        std::string data(rand() % 100, 'a');
+        for (char &c : data)
+            c = "ab\r\n:;"[rand() % 6];
+        const char *b = data.data(), *e = b + data.size();
+        scan_ok = scan_char(b, e, '\n') == scan_char_scalar(b, e, '\n') &&
+                  scan_crlf(b, e) == scan_crlf_scalar(b, e) &&
+                  scan_any(b, e, delims) == scan_any_scalar(b, e, delims);
+#ifdef SCANNER_X86
+        scan_ok = scan_ok && scan_char_sse2(b, e, '\n') == scan_char_scalar(b, e, '\n') &&
+                  scan_crlf_sse2(b, e) == scan_crlf_scalar(b, e) &&
+                  scan_any_sse2(b, e, delims) == scan_any_scalar(b, e, delims);
+#endif
+    }
+    if (!scan_ok)
+        LOG_MSG(ERROR, "simd scan failed.");
+    else
+        LOG_MSG(INFO, "simd scan passed.");
+
+    // 测试完整请求解析
+    std::string request = "GET /index.html?x=1 HTTP/1.1\r\n"
+                          "Host: example.com\r\n"
+                          "Content-Length:  12 \r\n"
+                          "Connection: keep-alive\r\n"
+                          "\r\n"
+                          "body";
+    Buffer buffer;
+    buffer.write_string(request);
+    HttpRequestParser parser;
+    if (parser.parse(buffer) != HttpParseResult::COMPLETE || parser.method() != "GET" || parser.path() != "/index.html?x=1" ||
+        parser.version() != "HTTP/1.1" || parser.header_count() != 3 || parser.get_header("content-length") != "12" ||
+        parser.message_size() != request.size() - 4)
+        LOG_MSG(ERROR, "http parse failed.");
+    else
+        LOG_MSG(INFO, "http parse passed.");
+
+    // 测试请求分多次到达 每次只到达一个字节 包括CR与LF被拆开的情况
+    Buffer partial(16);
+    HttpRequestParser incremental;
+    HttpParseResult result = HttpParseResult::INCOMPLETE;
+    size_t fed = 0;
+    for (; fed < request.size() && result == HttpParseResult::INCOMPLETE; fed++)
+    {
+        partial.write(&request[fed], 1);
+        result = incremental.parse(partial);
+    }
+    if (result != HttpParseResult::COMPLETE || fed != request.size() - 4 || incremental.get_header("Host") != "example.com" ||
+        incremental.path() != "/index.html?x=1")
+        LOG_MSG(ERROR, "http incremental parse failed.");
+    else
+        LOG_MSG(INFO, "http incremental parse passed.");
+
+    // 测试格式错误的请求
+    Buffer bad;
+    bad.write_string("GET /\r\n\r\n");
+    HttpRequestParser bad_parser;
+    if (bad_parser.parse(bad) != HttpParseResult::BAD_REQUEST)
+        LOG_MSG(ERROR, "http bad request failed.");
+    else
+        LOG_MSG(INFO, "http bad request passed.");
+
+    // 测试头部超长
+    Buffer huge;
+    huge.write_string("GET / HTTP/1.1\r\nX: " + std::string(HTTP_MAX_HEADER_SIZE, 'x'));
+    HttpRequestParser huge_parser;
+    if (huge_parser.parse(huge) != HttpParseResult::BAD_REQUEST)
+        LOG_MSG(ERROR, "http header limit failed.");
+    else
+        LOG_MSG(INFO, "http header limit passed.");
+
+    // 测试查看行数据 不拷贝且去掉CRLF
+    Buffer lines;
+    lines.write_string("first\r\nsecond\n");
+    size_t line_size = 0;
+    std::string_view line = lines.peek_line(&line_size);
+    lines.move_read_off(line_size);
+    std::string_view line2 = lines.peek_line(&line_size);
+    if (line != "first" || line2 != "second")
+        LOG_MSG(ERROR, "peek_line failed.");
+    else
+        LOG_MSG(INFO, "peek_line passed.");
+
+    LOG_MSG(INFO, "HttpRequestParser test finished.");
+}
@@ -0,0 +1,73 @@
+#include <fstream>
+#include "../../src/log.hpp"
+
+// 统计文件行数
+static size_t count_lines(const std::string &path)
+{
+    std::ifstream in(path);
+    std::string line;
+    size_t lines = 0;
+    while (std::getline(in, line))
+        lines++;
+    return lines;
+}
+
+int main()
+{
+    const std::string path = "/tmp/asynclog_test.log";
+    remove(path.c_str());
+
+    // 测试多线程写入异步日志 刷新后所有日志都已写入文件
+    start_async_logging(path);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([]()
+                             {
+            for (int i = 0; i < 10000; i++)
+                LOG_MSG(INFO, "async log message " + std::to_string(i)); });
+    for (std::thread &thread : threads)
+        thread.join();
+    flush_async_logging();
+    size_t lines = count_lines(path);
+    stop_async_logging();
+
+    if (lines != 40000)
+        LOG_MSG(ERROR, "async logging failed. lines=" + std::to_string(lines));
+    else
+        LOG_MSG(INFO, "async logging passed.");
+
+    // 测试过滤级别以下的日志不写入
+    remove(path.c_str());
+    start_async_logging(path);
+    LOG_MSG(DEBUG, "filtered");
+    LOG_MSG(WARN, "kept");
+    stop_async_logging();
+    if (count_lines(path) != 1)
+        LOG_MSG(ERROR, "async level filter failed.");
+    else
+        LOG_MSG(INFO, "async level filter passed.");
+
+    // 测试其他线程写日志时替换后端 每条日志都写入某个后端 旧后端释放前写出全部日志
+    remove(path.c_str());
+    start_async_logging(path);
+    threads.clear();
+    for (int t = 0; t < 4; t++)
+        threads.emplace_back([]()
+                             {
+            for (int i = 0; i < 5000; i++)
+                LOG_MSG(INFO, "replaced log message " + std::to_string(i)); });
+    for (int i = 0; i < 20; i++)
+        start_async_logging(path);
+    for (std::thread &thread : threads)
+        thread.join();
+    stop_async_logging();
+    lines = count_lines(path);
+    if (lines != 20000)
+        LOG_MSG(ERROR, "async logging restart failed. lines=" + std::to_string(lines));
+    else
+        LOG_MSG(INFO, "async logging restart passed.");
+
+    remove(path.c_str());
+    LOG_MSG(INFO, "AsyncLogging test finished.");
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include "../../src/log.hpp"
+
+static int evaluated = 0; // 消息参数被求值的次数
+
+// 构造消息时计数 用于检查被过滤的日志是否求值参数
+static std::string make_msg()
+{
+    evaluated++;
+    return "message";
+}
+
+// 格式化到字符串 用于比较结果
+template <typename... Args>
+static std::string format(std::string_view fmt, const Args &...args)
+{
+    char buf[256];
+    LogFormatter formatter(buf, sizeof(buf));
+    formatter.format(fmt, args...);
+    return std::string(buf, formatter.size());
+}
+
+enum Color
+{
+    COLOR_RED = 3
+};
+
+int main()
+{
+    // 测试各类型参数的格式化
+    std::string str = "str";
+    bool ok = format("a={} b={} c={} d={} e={}", 42, -7L, "text", str, std::string_view("view")) == "a=42 b=-7 c=text d=str e=view" &&
+              format("{} {} {} {}", true, 'x', 2.5, 18446744073709551615ull) == "true x 2.5 18446744073709551615" &&
+              format("color={}", COLOR_RED) == "color=3" &&
+              format("no args") == "no args";
+    if (!ok)
+        LOG_MSG(ERROR, "LogFormatter types failed.");
+    else
+        LOG_MSG(INFO, "LogFormatter types passed.");
+
+    // 测试转义 占位符与参数数量不一致
+    ok = format("{{}} {}", 1) == "{} 1" &&
+         format("{} {}", 1) == "1 {}" &&
+         format("{}", 1, 2) == "1" &&
+         format("{ } {", 1) == "{ } {";
+    if (!ok)
+        LOG_MSG(ERROR, "LogFormatter placeholders failed.");
+    else
+        LOG_MSG(INFO, "LogFormatter placeholders passed.");
+
+    // 测试超出缓冲区时截断
+    char small[8];
+    LogFormatter formatter(small, sizeof(small));
+    formatter.format("{}{}", "12345", "67890");
+    if (formatter.size() != sizeof(small) || memcmp(small, "12345678", 8) != 0)
+        LOG_MSG(ERROR, "LogFormatter truncate failed.");
+    else
+        LOG_MSG(INFO, "LogFormatter truncate passed.");
+
+    // 测试被过滤的日志不求值参数
+    set_log_level(WARN);
+    LOG_MSG(INFO, make_msg());
+    LOG_FMT(DEBUG, "{}", make_msg());
+    int filtered = evaluated;
+    if (true)
+        LOG_MSG(WARN, make_msg());
+    else
+        LOG_MSG(WARN, make_msg());
+    set_log_level(INFO);
+    if (filtered != 0 || evaluated != 1)
+        LOG_MSG(ERROR, "lazy evaluation failed.");
+    else
+        LOG_MSG(INFO, "lazy evaluation passed.");
+
+    LOG_FMT(INFO, "{} test finished.", "LogFormatter");
+    return 0;
+}
@@ -0,0 +1,109 @@
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include "../../src/acceptor.hpp"
+#include "../../src/sock.hpp"
+#include "../../src/log.hpp"
+
+static const int CLIENT_COUNT = 64; // 测试的客户端连接数
+
+// 发起连接 连接在监听队列中完成三次握手 返回客户端描述符
+static int connect_client(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+        LOG_MSG(ERROR, "connect failed.");
+    return fd;
+}
+
+int main()
+{
+    // 测试一次可读事件中批量获取所有连接 新连接为非阻塞且设置CLOEXEC
+    {
+        EventLoop loop;
+        Acceptor acceptor(&loop, 8895);
+        std::vector<int> accepted;
+        acceptor.set_accept_callback([&](int fd)
+                                     { accepted.push_back(fd); });
+        acceptor.listen();
+
+        std::vector<int> clients;
+        for (int i = 0; i < CLIENT_COUNT; i++)
+            clients.push_back(connect_client(8895));
+
+        loop.run_after(50 * 1000, [&]()
+                       { loop.quit(); });
+        loop.loop();
+
+        bool flags_ok = !accepted.empty();
+        for (int fd : accepted)
+        {
+            flags_ok = flags_ok && (fcntl(fd, F_GETFL) & O_NONBLOCK) && (fcntl(fd, F_GETFD) & FD_CLOEXEC);
+            close(fd);
+        }
+        for (int fd : clients)
+            close(fd);
+
+        if (accepted.size() != CLIENT_COUNT || !flags_ok)
+            LOG_MSG(ERROR, "batched accept failed.");
+        else
+            LOG_MSG(INFO, "batched accept passed.");
+    }
+
+    // 测试描述符耗尽时关闭新连接而不是忙循环
+    {
+        EventLoop loop;
+        Acceptor acceptor(&loop, 8896);
+        int accepted = 0;
+        acceptor.set_accept_callback([&](int fd)
+                                     { accepted++; close(fd); });
+        acceptor.listen();
+
+        std::vector<int> clients;
+        for (int i = 0; i < 4; i++)
+            clients.push_back(connect_client(8896));
+
+        // 降低描述符上限并占满剩余描述符
+        struct rlimit old_limit;
+        getrlimit(RLIMIT_NOFILE, &old_limit);
+        int highest = clients.back();
+        struct rlimit limit = old_limit;
+        limit.rlim_cur = highest + 1;
+        setrlimit(RLIMIT_NOFILE, &limit);
+        std::vector<int> fillers;
+        int filler = -1;
+        while ((filler = open("/dev/null", O_RDONLY)) != -1)
+            fillers.push_back(filler);
+
+        loop.run_after(50 * 1000, [&]()
+                       { loop.quit(); });
+        loop.loop();
+
+        for (int fd : fillers)
+            close(fd);
+        setrlimit(RLIMIT_NOFILE, &old_limit);
+
+        // 被关闭的连接在客户端读到EOF
+        int closed = 0;
+        for (int fd : clients)
+        {
+            char buf[1];
+            if (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) == 0)
+                closed++;
+            close(fd);
+        }
+
+        if (accepted != 0 || closed != 4)
+            LOG_MSG(ERROR, "fd exhaustion shedding failed. closed=" + std::to_string(closed));
+        else
+            LOG_MSG(INFO, "fd exhaustion shedding passed.");
+    }
+
+    LOG_MSG(INFO, "Acceptor test finished.");
+    return 0;
+}
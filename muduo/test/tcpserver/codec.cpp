@@ -0,0 +1,142 @@
+#include <string>
+#include <atomic>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include "../../src/tcpserver.hpp"
+#include "../../src/codec.hpp"
+#include "../../src/log.hpp"
+
+static const size_t MAX_FRAME = 1024 * 1024; // 测试使用的最大消息体长度
+
+// 阻塞地连接服务器 返回客户端描述符
+static int connect_client(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+        LOG_MSG(ERROR, "connect failed.");
+    return fd;
+}
+
+// 读取count条消息 返回各消息体 对端关闭时提前返回
+static std::vector<std::string> read_frames(int fd, size_t count)
+{
+    std::vector<std::string> frames;
+    Buffer buffer;
+    int saved_errno = 0;
+    while (frames.size() < count)
+    {
+        if (buffer.readable_size() >= CODEC_HEADER_SIZE && buffer.readable_size() >= CODEC_HEADER_SIZE + buffer.peek_uint32())
+        {
+            size_t len = buffer.read_uint32();
+            frames.push_back(buffer.read_string(len));
+            continue;
+        }
+        if (buffer.read_from_fd(fd, &saved_errno) <= 0)
+            break;
+    }
+    return frames;
+}
+
+// 测试伪造的长度头 对端声明最大长度的消息却只发送长度头 服务端不按声明的长度分配内存
+void test_forged_length()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8915);
+    server.set_thread_count(1);
+    LengthHeaderCodec codec([](const TcpConnectionPtr &, std::string_view) {});
+    std::atomic<size_t> capacity(0);
+    server.set_message_callback([&](const TcpConnectionPtr &conn, Buffer *buffer)
+                                {
+        codec.on_message(conn, buffer);
+        capacity = buffer->readable_size() + buffer->writeable_size(); });
+    server.start();
+
+    std::thread client([&]()
+                       {
+        Buffer forged;
+        forged.write_uint32(CODEC_MAX_FRAME_SIZE);
+        forged.write_string(std::string(100, 'x'));
+        int fd = connect_client(8915);
+        write(fd, forged.begin_read(), forged.readable_size());
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        close(fd);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    if (capacity == 0 || capacity > 1024 * 1024)
+        LOG_FMT(ERROR, "codec forged length failed. capacity={}", capacity.load());
+    else
+        LOG_FMT(INFO, "codec forged length passed. capacity={}", capacity.load());
+}
+
+int main()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8908);
+    server.set_thread_count(1);
+    LengthHeaderCodec codec([&codec](const TcpConnectionPtr &conn, std::string_view frame)
+                            { codec.send(conn, frame); },
+                            MAX_FRAME);
+    server.set_message_callback(std::bind(&LengthHeaderCodec::on_message, &codec, std::placeholders::_1, std::placeholders::_2));
+    server.start();
+
+    std::vector<std::string> sent = {"hello", "", std::string(100000, 'x')};
+    std::vector<std::string> echoed;
+    ssize_t oversized = -1;
+    std::thread client([&]()
+                       {
+        // 消息按帧编码后分多次写入 长度头也被拆开 服务端需等待完整的消息
+        Buffer out;
+        for (const std::string &frame : sent)
+        {
+            out.write_uint32(frame.size());
+            out.write_string(frame);
+        }
+        int fd = connect_client(8908);
+        write(fd, out.begin_read(), 2);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        write(fd, out.begin_read() + 2, 5);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        write(fd, out.begin_read() + 7, out.readable_size() - 7);
+        echoed = read_frames(fd, sent.size());
+        close(fd);
+
+        // 长度超过上限 服务端关闭连接
+        fd = connect_client(8908);
+        Buffer bad;
+        bad.write_uint32(MAX_FRAME + 1);
+        write(fd, bad.begin_read(), bad.readable_size());
+        char buf[16];
+        oversized = read(fd, buf, sizeof(buf));
+        close(fd);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+
+    if (echoed != sent)
+        LOG_FMT(ERROR, "codec echo failed. frames={}", echoed.size());
+    else
+        LOG_MSG(INFO, "codec echo passed.");
+
+    if (oversized != 0)
+        LOG_MSG(ERROR, "codec max frame failed.");
+    else
+        LOG_MSG(INFO, "codec max frame passed.");
+
+    // 超过上限的消息体不发送
+    if (codec.send(TcpConnectionPtr(), std::string(MAX_FRAME + 1, 'x')))
+        LOG_MSG(ERROR, "codec send limit failed.");
+    else
+        LOG_MSG(INFO, "codec send limit passed.");
+
+    test_forged_length();
+    LOG_MSG(INFO, "Codec test finished.");
+}
@@ -0,0 +1,197 @@
+#include <set>
+#include <memory>
+#include <vector>
+#include "../../src/tcpserver.hpp"
+#include "../../src/tcpclient.hpp"
+#include "../../src/connector.hpp"
+#include "../../src/log.hpp"
+
+static const uint64_t TEST_TIMEOUT_US = 5 * 1000 * 1000; // 每项测试的超时时间 防止测试挂起
+
+// 测试连接器重试 服务器晚于连接器启动 连接器按退避重试直到连接成功
+void test_connector_retry()
+{
+    EventLoop loop;
+    std::unique_ptr<TcpServer> server;
+    loop.run_after(100 * 1000, [&]()
+                   {
+        server.reset(new TcpServer(&loop, 8904));
+        server->set_thread_count(1);
+        server->start(); });
+
+    int retries = 0;
+    bool connected = false;
+    std::shared_ptr<Connector> connector = std::make_shared<Connector>(&loop, "127.0.0.1", 8904);
+    Connector *raw = connector.get(); // 回调中不能持有connector自身 否则形成循环引用
+    connector->set_retry_delay(10, 40);
+    connector->set_new_connection_callback([&, raw](int fd)
+                                           {
+        connected = true;
+        retries = raw->retries();
+        close(fd);
+        loop.quit(); });
+    connector->start();
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    server.reset();
+    if (!connected || retries == 0)
+        LOG_FMT(ERROR, "connector retry failed. retries={}", retries);
+    else
+        LOG_FMT(INFO, "connector retry passed. retries={}", retries);
+}
+
+// 测试连接器放弃 没有服务器监听 超过最大重试次数后回调错误码
+void test_connector_give_up()
+{
+    EventLoop loop;
+    int error = 0;
+    std::shared_ptr<Connector> connector = std::make_shared<Connector>(&loop, "127.0.0.1", 8905);
+    connector->set_retry_delay(5, 10);
+    connector->set_max_retries(2);
+    connector->set_new_connection_callback([&](int fd)
+                                           {
+        close(fd);
+        loop.quit(); });
+    connector->set_error_callback([&](int err)
+                                  {
+        error = err;
+        loop.quit(); });
+    connector->start();
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    if (error != ECONNREFUSED || connector->retries() != 3)
+        LOG_FMT(ERROR, "connector give up failed. errno={} retries={}", error, connector->retries());
+    else
+        LOG_MSG(INFO, "connector give up passed.");
+}
+
+// 测试连接复用 依次发送10个请求 每个请求取得连接 收到回显后归还 全部复用同一个连接
+void test_pool_reuse()
+{
+    EventLoop loop;
+    TcpServer server(&loop, 8906);
+    server.set_thread_count(1);
+    server.set_message_callback([](const TcpConnectionPtr &conn, Buffer *buffer)
+                                { conn->send(buffer); });
+    server.start();
+
+    TcpClient client(&loop);
+    client.set_tcp_no_delay(true);
+    std::set<uint64_t> ids;
+    int replies = 0;
+    std::function<void()> request = [&]()
+    {
+        client.acquire("127.0.0.1", 8906, [&](const TcpConnectionPtr &conn)
+                       {
+            if (!conn)
+            {
+                loop.quit();
+                return;
+            }
+            ids.insert(conn->id());
+            conn->set_message_callback([&](const TcpConnectionPtr &conn, Buffer *buffer)
+                                       {
+                if (buffer->readable_size() < 4)
+                    return;
+                buffer->move_read_off(4);
+                client.release(conn);
+                if (++replies == 10)
+                    loop.quit();
+                else
+                    request(); });
+            conn->send("ping"); });
+    };
+    request();
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    if (replies != 10 || ids.size() != 1 || client.connection_count("127.0.0.1", 8906) != 1 || client.idle_count("127.0.0.1", 8906) != 1)
+        LOG_FMT(ERROR, "pool reuse failed. replies={} connections={}", replies, ids.size());
+    else
+        LOG_MSG(INFO, "pool reuse passed.");
+}
+
+// 测试连接上限与预热 预热2个连接 上限为2时第3个请求等待归还的连接
+void test_pool_limit()
+{
+    EventLoop loop;
+    TcpServer server(&loop, 8907);
+    server.set_thread_count(1);
+    server.start();
+
+    TcpClient client(&loop);
+    client.set_max_connections(2);
+    client.warm_up("127.0.0.1", 8907, 2);
+
+    size_t warmed = 0;
+    std::vector<TcpConnectionPtr> held;
+    uint64_t handed_over = 0;
+    loop.run_after(100 * 1000, [&]()
+                   {
+        warmed = client.idle_count("127.0.0.1", 8907);
+        for (int i = 0; i < 3; i++)
+            client.acquire("127.0.0.1", 8907, [&](const TcpConnectionPtr &conn)
+                           {
+                if (!conn)
+                    return;
+                if (held.size() == 2)
+                {
+                    handed_over = conn->id();
+                    loop.quit();
+                    return;
+                }
+                held.push_back(conn); });
+        // 前两个请求立即取得预热的连接 归还其中一个后交给第三个请求
+        if (held.size() == 2)
+            client.release(held[0]); });
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    bool ok = warmed == 2 && held.size() == 2 && handed_over == held[0]->id() &&
+              client.connection_count("127.0.0.1", 8907) == 2;
+    if (!ok)
+        LOG_FMT(ERROR, "pool limit failed. warmed={} held={}", warmed, held.size());
+    else
+        LOG_MSG(INFO, "pool limit passed.");
+}
+
+// 测试连接失败 上限为1时多个请求等待同一个连接 连接失败后所有等待的请求都以失败回调
+void test_pool_connect_failed()
+{
+    EventLoop loop;
+    TcpClient client(&loop);
+    client.set_max_connections(1);
+    client.set_max_retries(1);
+    client.set_retry_delay(5, 10);
+
+    int failed = 0;
+    for (int i = 0; i < 3; i++)
+        client.acquire("127.0.0.1", 8914, [&](const TcpConnectionPtr &conn)
+                       {
+            if (!conn && ++failed == 3)
+                loop.quit(); });
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    if (failed != 3 || client.connection_count("127.0.0.1", 8914) != 0)
+        LOG_FMT(ERROR, "pool connect failure failed. failed={}", failed);
+    else
+        LOG_MSG(INFO, "pool connect failure passed.");
+}
+
+int main()
+{
+    test_connector_retry();
+    test_connector_give_up();
+    test_pool_reuse();
+    test_pool_limit();
+    test_pool_connect_failed();
+    LOG_MSG(INFO, "TcpClient test finished.");
+}
@@ -0,0 +1,356 @@
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <future>
+#include "../../src/tcpserver.hpp"
+#include "../../src/sock.hpp"
+#include "../../src/log.hpp"
+
+static const size_t BULK_SIZE = 16 * 1024 * 1024; // 高水位测试发送的数据量
+static const size_t HIGH_WATER = 1024 * 1024;     // 高水位测试使用的高水位
+static const size_t REPLY_SIZE = 4 * 1024 * 1024; // 半关闭测试的应答数据量
+
+// 阻塞地连接服务器 返回客户端描述符
+static int connect_client(int port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    bzero(&addr, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1)
+        LOG_MSG(ERROR, "connect failed.");
+    return fd;
+}
+
+// 读取直到对端关闭 返回读取的字节数
+static size_t read_until_eof(int fd)
+{
+    size_t total = 0;
+    char buf[64 * 1024];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+        total += n;
+    return total;
+}
+
+// 测试回显 收到的数据原样发回
+void test_echo()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8898);
+    server.set_thread_count(1);
+    server.set_message_callback([](const TcpConnectionPtr &conn, Buffer *buffer)
+                                { conn->send(buffer); });
+    server.start();
+
+    std::string reply;
+    std::thread client([&]()
+                       {
+        int fd = connect_client(8898);
+        write(fd, "hello", 5);
+        char buf[16];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0)
+            reply.assign(buf, n);
+        close(fd);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    if (reply != "hello")
+        LOG_MSG(ERROR, "echo failed.");
+    else
+        LOG_MSG(INFO, "echo passed.");
+}
+
+// 测试高水位 对端不读取时待发送数据越过高水位回调 发送完毕后回调write_complete
+void test_high_water_mark()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8899);
+    server.set_thread_count(1);
+
+    std::atomic<size_t> high_water_len(0);
+    std::atomic<int> write_complete(0);
+    server.set_connection_callback([](const TcpConnectionPtr &conn)
+                                   {
+        if (conn->connected())
+            conn->send(std::string(BULK_SIZE, 'x')); });
+    server.set_high_water_mark_callback([&](const TcpConnectionPtr &, size_t len)
+                                        { high_water_len = len; },
+                                        HIGH_WATER);
+    server.set_write_complete_callback([&](const TcpConnectionPtr &conn)
+                                       {
+        write_complete++;
+        conn->shutdown(); });
+    server.start();
+
+    size_t received = 0;
+    std::thread client([&]()
+                       {
+        int fd = connect_client(8899);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100)); // 慢速读取方
+        received = read_until_eof(fd);
+        close(fd);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    if (high_water_len < HIGH_WATER || write_complete != 1 || received != BULK_SIZE)
+        LOG_MSG(ERROR, "high water mark failed.");
+    else
+        LOG_FMT(INFO, "high water mark passed. pending={}", high_water_len.load());
+}
+
+// 测试半关闭 对端关闭写端后仍发送完剩余数据再关闭连接
+void test_half_close()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8900);
+    server.set_thread_count(1);
+
+    std::atomic<bool> disconnected(false);
+    server.set_connection_callback([&](const TcpConnectionPtr &conn)
+                                   {
+        if (conn->disconnected())
+            disconnected = true; });
+    server.set_message_callback([](const TcpConnectionPtr &conn, Buffer *buffer)
+                                {
+        buffer->move_read_off(buffer->readable_size());
+        conn->send(std::string(REPLY_SIZE, 'y')); });
+    server.start();
+
+    size_t received = 0;
+    std::thread client([&]()
+                       {
+        int fd = connect_client(8900);
+        write(fd, "bye", 3);
+        shutdown(fd, SHUT_WR);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100)); // 服务端先收到EOF 再读取应答
+        received = read_until_eof(fd);
+        close(fd);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    if (received != REPLY_SIZE || !disconnected || server.connection_count() != 0)
+        LOG_MSG(ERROR, "half close failed.");
+    else
+        LOG_MSG(INFO, "half close passed.");
+}
+
+// 测试空闲回收 没有读写活动的连接被关闭 持续活跃的连接不受影响
+void test_idle_timeout()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8901);
+    server.set_thread_count(1);
+    server.set_idle_timeout(200, 10);
+    server.set_message_callback([](const TcpConnectionPtr &, Buffer *buffer)
+                                { buffer->move_read_off(buffer->readable_size()); });
+    server.start();
+
+    bool idle_closed = false, active_alive = false;
+    std::thread client([&]()
+                       {
+        int idle = connect_client(8901);
+        int active = connect_client(8901);
+        uint64_t start = timer_now();
+
+        // 活跃连接每50毫秒发送一次 持续超过空闲超时的两倍
+        for (int i = 0; i < 10; i++)
+        {
+            write(active, "x", 1);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        char c;
+        active_alive = recv(active, &c, 1, MSG_DONTWAIT) == -1 && errno == EAGAIN;
+
+        // 空闲连接应在超时后很快被关闭
+        idle_closed = read(idle, &c, 1) == 0 && timer_now() - start < 1000 * 1000;
+        close(idle);
+        close(active);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    if (!idle_closed || !active_alive)
+        LOG_MSG(ERROR, "idle timeout failed.");
+    else
+        LOG_MSG(INFO, "idle timeout passed.");
+}
+
+// 测试发送管道数据 管道暂无数据时等待管道可读 而不是监控可写事件空转
+void test_send_pipe()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8911);
+    server.set_thread_count(1);
+
+    int pipe_fds[2];
+    pipe(pipe_fds);
+    std::atomic<EventLoop *> io_loop(nullptr);
+    server.set_connection_callback([&](const TcpConnectionPtr &conn)
+                                   {
+        if (!conn->connected())
+            return;
+        conn->send_file(pipe_fds[0], 0, 5);
+        io_loop = conn->owner_loop(); });
+    server.start();
+
+    uint64_t wakeups = 0;
+    std::string reply;
+    std::thread client([&]()
+                       {
+        int fd = connect_client(8911);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        if (io_loop)
+            wakeups = io_loop.load()->metrics().wakeups.load();
+
+        // 管道中写入数据后继续发送
+        write(pipe_fds[1], "hello", 5);
+        char buf[16];
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0)
+            reply.assign(buf, n);
+        close(fd);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+    if (io_loop == nullptr || wakeups > 100 || reply != "hello")
+        LOG_FMT(ERROR, "send pipe failed. wakeups={} reply={}", wakeups, reply);
+    else
+        LOG_FMT(INFO, "send pipe passed. wakeups={}", wakeups);
+}
+
+// 测试对端重置 输出缓冲区中仍有待发送的内存数据和文件数据时对端重置连接 连接被关闭而进程不因SIGPIPE退出
+void test_peer_reset()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8913);
+    server.set_thread_count(1);
+
+    char path[] = "/tmp/tcpconnection_fileXXXXXX";
+    int file_fd = mkstemp(path);
+    std::string content(BULK_SIZE, 'f');
+    write(file_fd, content.data(), content.size());
+    std::atomic<bool> disconnected(false);
+    server.set_connection_callback([&](const TcpConnectionPtr &conn)
+                                   {
+        if (conn->disconnected())
+        {
+            disconnected = true;
+            return;
+        }
+        conn->send(std::string(BULK_SIZE, 'x'));
+        conn->send_file(file_fd, 0, content.size()); });
+    server.start();
+
+    std::thread client([&]()
+                       {
+        int fd = connect_client(8913);
+        char buf[4096];
+        read(fd, buf, sizeof(buf));
+        struct linger lg = {1, 0}; // 关闭时发送RST
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+        close(fd);
+        for (int i = 0; i < 100 && !disconnected; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    close(file_fd);
+    unlink(path);
+    if (!disconnected || server.connection_count() != 0)
+        LOG_MSG(ERROR, "peer reset failed.");
+    else
+        LOG_MSG(INFO, "peer reset passed.");
+}
+
+// 测试零拷贝发送 共享的数据块不拷贝地发送两次 开启零拷贝后较大的内存数据也不直接拷贝进内核
+// 回环地址上内核会拷贝数据并在完成通知中注明 因此只检查数据完整且经过了MSG_ZEROCOPY发送
+void test_zerocopy()
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, 8916);
+    server.set_thread_count(1);
+
+    std::string content(1024 * 1024, '\0');
+    for (size_t i = 0; i < content.size(); i++)
+        content[i] = static_cast<char>('a' + i % 26);
+    BlockRef block(ChainBlock::create(content.size()));
+    block->append(content.data(), content.size());
+    std::string tail(64 * 1024, 't');
+
+    std::atomic<bool> enabled(false);
+    TcpConnectionPtr saved;
+    std::promise<void> ready;
+    server.set_connection_callback([&](const TcpConnectionPtr &conn)
+                                   {
+        if (!conn->connected())
+            return;
+        enabled = conn->enable_zerocopy();
+        ChainBuffer chain;
+        chain.append_slice(block, 0, content.size());
+        conn->send(chain);
+        conn->send(block, 0, content.size());
+        conn->send(tail);
+        saved = conn;
+        ready.set_value(); });
+    server.start();
+
+    std::string received;
+    size_t copied = 0;
+    std::thread client([&]()
+                       {
+        int fd = connect_client(8916);
+        ready.get_future().wait();
+        char buf[64 * 1024];
+        while (received.size() < 2 * content.size() + tail.size())
+        {
+            ssize_t n = read(fd, buf, sizeof(buf));
+            if (n <= 0)
+                break;
+            received.append(buf, n);
+        }
+
+        // 等待错误队列中的完成通知被处理
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::promise<size_t> stats;
+        saved->owner_loop()->queue_in_loop([&]()
+                                           {
+            size_t n = saved->output_buffer()->zerocopy_copied();
+            saved.reset(); // 在所属线程中释放连接
+            stats.set_value(n); });
+        copied = stats.get_future().get();
+        close(fd);
+        base_loop.quit(); });
+
+    base_loop.loop();
+    client.join();
+    if (!enabled)
+        LOG_MSG(WARN, "zerocopy not supported, skipped.");
+    else if (received != content + content + tail || copied == 0 || block->use_count() != 1)
+        LOG_FMT(ERROR, "zerocopy send failed. received={} copied={}", received.size(), copied);
+    else
+        LOG_FMT(INFO, "zerocopy send passed. copied={}", copied);
+}
+
+int main()
+{
+    test_echo();
+    test_high_water_mark();
+    test_half_close();
+    test_idle_timeout();
+    test_send_pipe();
+    test_peer_reset();
+    test_zerocopy();
+
+    LOG_MSG(INFO, "TcpConnection test finished.");
+}
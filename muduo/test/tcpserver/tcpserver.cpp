@@ -0,0 +1,87 @@
+#include <set>
+#include <map>
+#include <mutex>
+#include "../../src/tcpserver.hpp"
+#include "../../src/sock.hpp"
+#include "../../src/log.hpp"
+
+static const int CLIENT_COUNT = 32; // 每轮测试的客户端连接数
+
+// 启动服务器并发起若干连接 返回每个事件循环处理的连接数
+std::map<EventLoop *, int> run_server(int port, AcceptMode mode, DispatchPolicy policy)
+{
+    EventLoop base_loop;
+    TcpServer server(&base_loop, port, mode);
+    server.set_thread_count(4);
+    server.set_dispatch_policy(policy);
+
+    std::mutex mutex;
+    std::map<EventLoop *, int> counts;
+    int total = 0;
+    server.set_connection_callback([&](const TcpConnectionPtr &conn)
+                                   {
+        if (!conn->connected())
+            return;
+        EventLoop *loop = conn->owner_loop();
+        if (!loop->is_in_loop_thread())
+            LOG_MSG(ERROR, "connection callback not in loop thread.");
+        conn->force_close();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        counts[loop]++;
+        if (++total == CLIENT_COUNT)
+            base_loop.quit(); });
+    server.start();
+
+    std::thread clients([port]()
+                        {
+        for (int i = 0; i < CLIENT_COUNT; i++)
+        {
+            Socket client;
+            client.Create();
+            client.Connect("127.0.0.1", port);
+        } });
+
+    base_loop.loop();
+    clients.join();
+    return counts;
+}
+
+int main()
+{
+    // 测试主事件循环监听 轮询分发
+    std::map<EventLoop *, int> counts = run_server(8891, AcceptMode::MAIN_ACCEPTOR, DispatchPolicy::ROUND_ROBIN);
+    bool even = counts.size() == 4;
+    for (auto &kv : counts)
+        even = even && kv.second == CLIENT_COUNT / 4;
+    if (!even)
+        LOG_MSG(ERROR, "round robin dispatch failed.");
+    else
+        LOG_MSG(INFO, "round robin dispatch passed.");
+
+    // 测试主事件循环监听 负载最小分发
+    counts = run_server(8892, AcceptMode::MAIN_ACCEPTOR, DispatchPolicy::LEAST_LOADED);
+    if (counts.size() != 4)
+        LOG_MSG(ERROR, "least loaded dispatch failed.");
+    else
+        LOG_MSG(INFO, "least loaded dispatch passed.");
+
+    // 测试端口复用 每个事件循环各自监听
+    counts = run_server(8893, AcceptMode::REUSE_PORT, DispatchPolicy::ROUND_ROBIN);
+    if (counts.size() < 2)
+        LOG_MSG(ERROR, "reuse port sharding failed.");
+    else
+        LOG_MSG(INFO, "reuse port sharding passed.");
+
+    // 测试共享监听套接字 独占唤醒
+    counts = run_server(8894, AcceptMode::EXCLUSIVE, DispatchPolicy::ROUND_ROBIN);
+    int total = 0;
+    for (auto &kv : counts)
+        total += kv.second;
+    if (total != CLIENT_COUNT)
+        LOG_MSG(ERROR, "exclusive accept failed.");
+    else
+        LOG_MSG(INFO, "exclusive accept passed.");
+
+    LOG_MSG(INFO, "TcpServer test finished.");
+}
@@ -1,138 +1,84 @@
-#include <sys/timerfd.h>
-#include <unordered_map>
-#include <functional>
-#include <stdio.h>
-#include <memory>
 #include <vector>
-#include "log.hpp"
-#include <unistd.h>
-
-using task_func = std::function<void()>;    // 定时器任务回调函数
-using release_func = std::function<void()>; // 定时器任务释放函数
-
-static const int DEFAULT_TICK = 0;        // 默认时间轮刻度
-static const int DEFAULT_WHEEL_SIZE = 60; // 默认时间轮容量
-
-// 定时器任务类
-class TimerTask
-{
-public:
-    TimerTask(uint64_t id, uint64_t interval, task_func task)
-        : id_(id), interval_(interval), task_(task), valid_(true) {}
-
-    ~TimerTask()
-    {
-        if (valid_)
-            task_(); // 执行定时器任务
-
-        release_(); // 释放定时器任务
-    }
-
-    // 设置定时器任务释放函数
-    void set_release(const release_func &release) { release_ = release; }
-
-    // 获取定时器任务时间间隔
-    uint64_t interval() const { return interval_; }
-
-    // 设置定时器任务无效
-    void set_invalid() { valid_ = false; }
-
-private:
-    uint64_t id_;          // 定时器任务id
-    uint64_t interval_;    // 定时器任务间隔
-    task_func task_;       // 定时器任务回调函数
-    release_func release_; // 定时器任务释放函数
-    bool valid_;           // 定时器任务是否有效
-};
-
-class TimerWheel
-{
-public:
-    TimerWheel(int capacity = DEFAULT_WHEEL_SIZE, int tick = DEFAULT_TICK)
-        : tick_(tick), capacity_(capacity), wheel_(capacity) {}
-
-    void timer_add(uint64_t id, uint64_t interval, task_func task)
-    {
-        // 无效的定时器间隔
-        if (interval <= 0)
-            return;
-
-        // 创建定时器任务
-        auto timer = std::make_shared<TimerTask>(id, interval, task);
-        timer->set_release(std::bind(&TimerWheel::remove_timer, this, id));
-
-        // 计算定时器任务位置
-        int pos = (tick_ + interval) % capacity_;
-        // 添加定时器任务
-        wheel_[pos].push_back(timer);
-        timers_[id] = std::weak_ptr<TimerTask>(timer);
-    }
-
-    void remove_timer(uint64_t id)
-    {
-        auto it = timers_.find(id);
-        if (it == timers_.end())
-            return;
-
-        timers_.erase(it); // 移除定时器任务
-    }
-
-    void refresh_timer(uint64_t id)
-    {
-        auto it = timers_.find(id);
-        // 定时器任务不存在
-        if (it == timers_.end())
-            return;
-
-        std::shared_ptr<TimerTask> timer = it->second.lock(); // 获取定时器任务
-        uint64_t interval = timer->interval();                // 获取定时器任务时间间隔
-        int pos = (tick_ + interval) % capacity_;             // 计算定时器任务位置
-        wheel_[pos].push_back(timer);                         // 添加定时器任务
-    }
-
-    void run_timer_task()
-    {
-        tick_ = (tick_ + 1) % capacity_; // 更新时间轮刻度
-        wheel_[tick_].clear();           // 清空时间轮刻度
-    }
-
-    void cancel_timer(uint64_t id)
-    {
-        auto it = timers_.find(id);
-        // 定时器任务不存在
-        if (it == timers_.end())
-            return;
-
-        std::shared_ptr<TimerTask> timer = it->second.lock(); // 获取定时器任务
-        timer->set_invalid();                                 // 设置定时器任务无效
-    }
-
-private:
-    int tick_;     // 时间轮刻度
-    int capacity_; // 时间轮容量
-
-    std::vector<std::vector<std::shared_ptr<TimerTask>>> wheel_;    // 时间轮
-    std::unordered_map<uint64_t, std::weak_ptr<TimerTask>> timers_; // 定时器任务
-};
+#include "../../src/timerwheel.hpp"
+#include "../../src/log.hpp"
 
 int main()
 {
-    // 创建时间轮
-    TimerWheel timer_wheel;
-    // 添加定时器任务
-    timer_wheel.timer_add(1, 5, []()
-                          { log_msg(INFO, "timer 1"); });
-    timer_wheel.timer_add(2, 2, []()
-                          { log_msg(INFO, "timer 2"); });
-    timer_wheel.timer_add(3, 15, []()
-                          { log_msg(INFO, "timer 3"); });
-
-    while (true)
+    TimerWheel wheel; // 每个刻度1毫秒
+
+    // 测试到期执行 包括需要多次降级的长定时器
+    std::vector<uint64_t> fired;
+    uint64_t intervals[] = {1, 255, 256, 300, 16384, 100000, 5000000};
+    for (uint64_t interval : intervals)
+        wheel.timer_add(interval, [&fired, &wheel]()
+                        { fired.push_back(wheel.current_tick()); });
+
+    wheel.advance(5000000);
+    bool ok = fired.size() == sizeof(intervals) / sizeof(intervals[0]);
+    for (size_t i = 0; ok && i < fired.size(); i++)
+        ok = fired[i] == intervals[i];
+    if (!ok || wheel.size() != 0)
+        LOG_MSG(ERROR, "timer expire failed.");
+    else
+        LOG_MSG(INFO, "timer expire passed.");
+
+    // 测试刷新 刷新后从当前时间重新计时
+    int refreshed = 0;
+    uint64_t id = wheel.timer_add(1000, [&refreshed]()
+                                  { refreshed++; });
+    uint64_t start = wheel.current_tick();
+    for (int i = 0; i < 10; i++)
     {
-        sleep(1);
-        log_msg(INFO, "tick");
-        timer_wheel.run_timer_task(); // 运行定时器任务
+        wheel.advance(wheel.current_tick() + 900);
+        wheel.refresh_timer(id);
     }
-
+    wheel.advance(wheel.current_tick() + 999);
+    bool not_yet = refreshed == 0;
+    wheel.advance(wheel.current_tick() + 1);
+    if (!not_yet || refreshed != 1 || wheel.current_tick() - start != 10000)
+        LOG_MSG(ERROR, "timer refresh failed.");
+    else
+        LOG_MSG(INFO, "timer refresh passed.");
+
+    // 测试取消 取消后任务不再执行 过期的id无法作用于复用的节点
+    int cancelled = 0;
+    id = wheel.timer_add(10, [&cancelled]()
+                         { cancelled++; });
+    wheel.cancel_timer(id);
+    uint64_t reused = wheel.timer_add(10, []() {});
+    wheel.advance(wheel.current_tick() + 20);
+    if (cancelled != 0 || wheel.cancel_timer(id) || wheel.has_timer(reused))
+        LOG_MSG(ERROR, "timer cancel failed.");
+    else
+        LOG_MSG(INFO, "timer cancel passed.");
+
+    // 测试超出时间轮范围的定时器
+    bool far_fired = false;
+    wheel.timer_add(WHEEL_MAX_TICKS * 2, [&far_fired]()
+                    { far_fired = true; });
+    uint64_t far_start = wheel.current_tick();
+    wheel.advance(far_start + WHEEL_MAX_TICKS * 2 - 1);
+    bool far_early = far_fired;
+    wheel.advance(far_start + WHEEL_MAX_TICKS * 2);
+    if (far_early || !far_fired)
+        LOG_MSG(ERROR, "timer beyond range failed.");
+    else
+        LOG_MSG(INFO, "timer beyond range passed.");
+
+    // 测试任务中添加定时器
+    int chained = 0;
+    std::function<void()> chain = [&]()
+    {
+        if (++chained < 3)
+            wheel.timer_add(5, chain);
+    };
+    wheel.timer_add(5, chain);
+    wheel.advance(wheel.current_tick() + 15);
+    if (chained != 3)
+        LOG_MSG(ERROR, "timer add in task failed.");
+    else
+        LOG_MSG(INFO, "timer add in task passed.");
+
+    LOG_MSG(INFO, "TimerWheel test finished.");
     return 0;
 }
@@ -0,0 +1,71 @@
+#include "../../src/eventloop.hpp"
+#include "../../src/log.hpp"
+
+int main()
+{
+    EventLoop loop;
+
+    // 测试run_after 亚毫秒精度的到期时间
+    uint64_t start = timer_now();
+    uint64_t fired_at = 0;
+    loop.run_after(500, [&]()
+                   { fired_at = timer_now(); });
+
+    // 测试run_every 执行5次后在回调中取消自身
+    int every_count = 0;
+    TimerId every = 0;
+    every = loop.run_every(1000, [&]()
+                           {
+        if (++every_count == 5)
+            loop.cancel(every); });
+
+    // 测试取消尚未到期的定时器
+    bool cancelled_fired = false;
+    TimerId cancelled = loop.run_after(2000, [&]()
+                                       { cancelled_fired = true; });
+    loop.cancel(cancelled);
+
+    // 测试取消其他线程刚添加的定时器 添加任务尚在任务队列中时在本线程取消
+    bool pending_fired = false;
+    loop.queue_in_loop([&]()
+                       {
+        TimerId pending = 0;
+        std::thread adder([&]()
+                          { pending = loop.run_after(1000, [&]()
+                                                     { pending_fired = true; }); });
+        adder.join();
+        loop.cancel(pending); });
+
+    // 测试run_at 以及其他线程添加定时器
+    std::thread other([&]()
+                      { loop.run_after(20000, [&]()
+                                       { loop.quit(); }); });
+    loop.run_at(start + 15000, []() {});
+
+    loop.loop();
+    other.join();
+
+    uint64_t delay = fired_at - start;
+    if (fired_at == 0 || delay < 500 || delay > 5000)
+        LOG_MSG(ERROR, "run_after failed. delay=" + std::to_string(delay));
+    else
+        LOG_MSG(INFO, "run_after passed.");
+
+    if (every_count != 5)
+        LOG_MSG(ERROR, "run_every failed.");
+    else
+        LOG_MSG(INFO, "run_every passed.");
+
+    if (cancelled_fired)
+        LOG_MSG(ERROR, "cancel failed.");
+    else
+        LOG_MSG(INFO, "cancel passed.");
+
+    if (pending_fired)
+        LOG_MSG(ERROR, "cancel pending add failed.");
+    else
+        LOG_MSG(INFO, "cancel pending add passed.");
+
+    LOG_MSG(INFO, "TimerQueue test finished.");
+    return 0;
+}
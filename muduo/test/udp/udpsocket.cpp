@@ -0,0 +1,118 @@
+#include <string>
+#include "../../src/eventloop.hpp"
+#include "../../src/udpsocket.hpp"
+#include "../../src/log.hpp"
+
+static const uint64_t TEST_TIMEOUT_US = 5 * 1000 * 1000; // 每项测试的超时时间 防止测试挂起
+static const int DATAGRAM_COUNT = 200;                   // 批量收发测试的数据报数
+
+// 测试批量收发 客户端一次投递200个数据报 服务端逐个回显 双方都以少于数据报数的系统调用完成收发
+void test_batch_echo()
+{
+    EventLoop loop;
+    UdpSocket server(&loop, 8909);
+    server.set_datagram_callback([&](std::string_view data, const struct sockaddr_in &peer)
+                                 { server.send_to(data, peer); });
+    server.start();
+
+    UdpSocket client(&loop, 0);
+    int echoed = 0;
+    bool ordered = true;
+    client.set_datagram_callback([&](std::string_view data, const struct sockaddr_in &)
+                                 {
+        ordered = ordered && data == std::to_string(echoed);
+        if (++echoed == DATAGRAM_COUNT)
+            loop.quit(); });
+    client.start();
+
+    struct sockaddr_in peer = udp_address("127.0.0.1", 8909);
+    for (int i = 0; i < DATAGRAM_COUNT; i++)
+        client.send_to(std::to_string(i), peer);
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    bool ok = echoed == DATAGRAM_COUNT && ordered && server.received() == DATAGRAM_COUNT &&
+              server.recv_calls() < DATAGRAM_COUNT / 2 && client.send_calls() < DATAGRAM_COUNT / 2 &&
+              server.send_calls() < DATAGRAM_COUNT / 2;
+    if (!ok)
+        LOG_FMT(ERROR, "udp batch echo failed. echoed={} recv_calls={} send_calls={}", echoed, server.recv_calls(), client.send_calls());
+    else
+        LOG_FMT(INFO, "udp batch echo passed. recv_calls={} send_calls={}", server.recv_calls(), client.send_calls());
+}
+
+// 测试GSO与GRO 等长数据报合并发送 接收端按分段大小拆分 内核不支持时退化为逐个数据报 结果应相同
+void test_gso_gro()
+{
+    EventLoop loop;
+    UdpSocket server(&loop, 8910);
+    bool gro = server.enable_gro();
+    int received = 0;
+    bool sizes_ok = true;
+    server.set_datagram_callback([&](std::string_view data, const struct sockaddr_in &)
+                                 {
+        sizes_ok = sizes_ok && data.size() == (received == 39 ? 500 : 1000) && data[0] == 'a' + received % 26;
+        if (++received == 40)
+            loop.quit(); });
+    server.start();
+
+    UdpSocket client(&loop, 0);
+    bool gso = client.enable_gso();
+    client.start();
+    struct sockaddr_in peer = udp_address("127.0.0.1", 8910);
+    for (int i = 0; i < 40; i++)
+        client.send_to(std::string(i == 39 ? 500 : 1000, 'a' + i % 26), peer);
+    client.flush();
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    // 开启GSO时40个数据报只需一条消息
+    bool ok = received == 40 && sizes_ok && (!gso || !client.gso_enabled() || client.send_calls() == 1);
+    if (!ok)
+        LOG_FMT(ERROR, "udp gso gro failed. received={} gso={} gro={}", received, gso, gro);
+    else
+        LOG_FMT(INFO, "udp gso gro passed. gso={} gro={} recv_calls={}", gso, gro, server.recv_calls());
+}
+
+// 测试GSO消息被拒绝 关闭发送校验和后内核拒绝GSO消息 合并的数据报应逐个重发而不是丢弃
+// 超过默认分段上限的数据报不合并
+void test_gso_rejected()
+{
+    EventLoop loop;
+    UdpSocket server(&loop, 8912);
+    int received = 0;
+    bool sizes_ok = true;
+    server.set_datagram_callback([&](std::string_view data, const struct sockaddr_in &)
+                                 {
+        sizes_ok = sizes_ok && data.size() == (received < 8 ? 1000 : 2000);
+        if (++received == 12)
+            loop.quit(); });
+    server.start();
+
+    UdpSocket client(&loop, 0);
+    bool gso = client.enable_gso();
+    int opt = 1;
+    setsockopt(client.fd(), SOL_SOCKET, SO_NO_CHECK, &opt, sizeof(opt));
+    client.start();
+    struct sockaddr_in peer = udp_address("127.0.0.1", 8912);
+    for (int i = 0; i < 12; i++)
+        client.send_to(std::string(i < 8 ? 1000 : 2000, 'x'), peer);
+    client.flush();
+    loop.run_after(TEST_TIMEOUT_US, [&]()
+                   { loop.quit(); });
+    loop.loop();
+
+    if (received != 12 || !sizes_ok || client.sent() != 12)
+        LOG_FMT(ERROR, "udp gso rejected failed. received={} sent={} gso={}", received, client.sent(), gso);
+    else
+        LOG_FMT(INFO, "udp gso rejected passed. gso={}", gso);
+}
+
+int main()
+{
+    test_batch_echo();
+    test_gso_gro();
+    test_gso_rejected();
+    LOG_MSG(INFO, "UdpSocket test finished.");
+}
@@ -0,0 +1,141 @@
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <future>
+#include <atomic>
+#include "../../src/workerpool.hpp"
+#include "../../src/eventloop.hpp"
+#include "../../src/log.hpp"
+
+static const int TASK_COUNT = 10000; // 提交的计算任务数
+
+int main()
+{
+    // 测试计算在工作线程中执行 完成回调回到提交任务的事件循环线程
+    {
+        EventLoop loop;
+        WorkerPool pool(4);
+        pool.start();
+
+        std::thread::id loop_thread = std::this_thread::get_id();
+        std::atomic<bool> work_off_loop(true);
+        bool done_in_loop = true;
+        int completed = 0;
+        uint64_t sum = 0;
+        for (int i = 0; i < TASK_COUNT; i++)
+        {
+            pool.submit(
+                &loop, [i, loop_thread, &work_off_loop]()
+                {
+                    if (std::this_thread::get_id() == loop_thread)
+                        work_off_loop = false;
+                    return static_cast<uint64_t>(i) * i; },
+                [&](uint64_t result)
+                {
+                    done_in_loop = done_in_loop && loop.is_in_loop_thread();
+                    sum += result;
+                    if (++completed == TASK_COUNT)
+                        loop.quit();
+                });
+        }
+        loop.loop();
+
+        uint64_t expected = 0;
+        for (uint64_t i = 0; i < TASK_COUNT; i++)
+            expected += i * i;
+        if (!work_off_loop || !done_in_loop || sum != expected)
+            LOG_MSG(ERROR, "submit with completion failed.");
+        else
+            LOG_MSG(INFO, "submit with completion passed.");
+    }
+
+    // 测试工作窃取 一个工作线程中派生的子任务被其他空闲线程窃取执行
+    {
+        WorkerPool pool(4);
+        pool.start();
+
+        std::atomic<int> finished(0);
+        std::promise<void> all_done;
+        pool.submit([&]()
+                    {
+            for (int i = 0; i < 64; i++)
+                pool.submit([&]()
+                            {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    if (++finished == 64)
+                        all_done.set_value(); }); });
+        all_done.get_future().wait();
+
+        if (pool.stolen() == 0)
+            LOG_MSG(ERROR, "work stealing failed.");
+        else
+            LOG_FMT(INFO, "work stealing passed. stolen={}", pool.stolen());
+    }
+
+    // 测试优先级 延迟敏感的任务先于先提交的批处理任务执行
+    {
+        WorkerPool pool(1);
+        pool.start();
+
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        pool.submit([released]()
+                    { released.wait(); }); // 占住唯一的工作线程
+
+        std::mutex mutex;
+        std::vector<TaskPriority> order;
+        for (int i = 0; i < 3; i++)
+            pool.submit([&]()
+                        {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(TaskPriority::BATCH); },
+                        TaskPriority::BATCH);
+        for (int i = 0; i < 3; i++)
+            pool.submit([&]()
+                        {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(TaskPriority::LATENCY); },
+                        TaskPriority::LATENCY);
+        release.set_value();
+        pool.stop(); // 执行完所有已提交的任务后返回
+
+        bool ok = order.size() == 6;
+        for (size_t i = 0; ok && i < order.size(); i++)
+            ok = order[i] == (i < 3 ? TaskPriority::LATENCY : TaskPriority::BATCH);
+        if (!ok)
+            LOG_MSG(ERROR, "task priority failed.");
+        else
+            LOG_MSG(INFO, "task priority passed.");
+    }
+
+    // 测试先进先出 其他线程提交的同一优先级任务按提交顺序执行
+    {
+        WorkerPool pool(1);
+        pool.start();
+
+        std::promise<void> release;
+        std::shared_future<void> released = release.get_future().share();
+        pool.submit([released]()
+                    { released.wait(); }); // 占住唯一的工作线程
+
+        std::mutex mutex;
+        std::vector<int> order;
+        for (int i = 0; i < 16; i++)
+            pool.submit([&, i]()
+                        {
+                std::lock_guard<std::mutex> lock(mutex);
+                order.push_back(i); });
+        release.set_value();
+        pool.stop();
+
+        bool ok = order.size() == 16;
+        for (size_t i = 0; ok && i < order.size(); i++)
+            ok = order[i] == static_cast<int>(i);
+        if (!ok)
+            LOG_MSG(ERROR, "task fifo failed.");
+        else
+            LOG_MSG(INFO, "task fifo passed.");
+    }
+
+    LOG_MSG(INFO, "WorkerPool test finished.");
+}